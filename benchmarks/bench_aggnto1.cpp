@@ -0,0 +1,88 @@
+// Compares the sequential aggnto1 fold with the parallel tree reduction for a growing number of threads.
+//
+// Build (from the repository root):
+//   g++ -O2 -std=c++14 -pthread benchmarks/bench_aggnto1.cpp src/DFO.cpp src/DFO_aggregation.cpp src/parallel.cpp src/instrumentation.cpp -o bench_aggnto1
+// or build the bench_aggnto1 target of benchmarks/CMakeLists.txt.
+// Run:
+//   ./bench_aggnto1 [num_dfos] [numsamples]
+
+#include "../include/DFO.h"
+#include "../include/DFO_aggregation.h"
+#include "../include/parallel.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+// Synthetic EV charging session: needs `energy` kWh within `duration` hours at up to `power` kW.
+static DFO make_ev_dfo(int id, mt19937& rng, int numsamples, time_t day_start) {
+    uniform_int_distribution<int> start_hour(16, 22);
+    uniform_int_distribution<int> duration_hours(4, 10);
+    uniform_real_distribution<double> energy_fraction(0.3, 0.9);
+    const double power = 7.3;
+
+    int duration = duration_hours(rng);
+    double energy = energy_fraction(rng) * duration * power;
+
+    vector<double> min_prev, max_prev;
+    for (int t = 0; t <= duration; t++) {
+        min_prev.push_back(max(0.0, energy - (duration - t) * power));
+        max_prev.push_back(min(energy, t * power));
+    }
+
+    DFO dfo(id, min_prev, max_prev, numsamples, power, -1, -1, day_start + start_hour(rng) * 3600);
+    dfo.generate_dependency_polygons();
+    return dfo;
+}
+
+static double max_abs_difference(const DFO& a, const DFO& b) {
+    if (a.polygons.size() != b.polygons.size()) return INFINITY;
+    double diff = 0.0;
+    for (size_t i = 0; i < a.polygons.size(); i++) {
+        const auto& pa = a.polygons[i].points;
+        const auto& pb = b.polygons[i].points;
+        if (pa.size() != pb.size()) return INFINITY;
+        for (size_t j = 0; j < pa.size(); j++) {
+            diff = max(diff, fabs(pa[j].x - pb[j].x));
+            diff = max(diff, fabs(pa[j].y - pb[j].y));
+        }
+    }
+    return diff;
+}
+
+template <typename F>
+static double time_ms(F&& f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int num_dfos = argc > 1 ? atoi(argv[1]) : 5000;
+    int numsamples = argc > 2 ? atoi(argv[2]) : 5;
+
+    mt19937 rng(42);
+    vector<DFO> dfos;
+    dfos.reserve(num_dfos);
+    for (int i = 0; i < num_dfos; i++) dfos.push_back(make_ev_dfo(i, rng, numsamples, 1700000000 / 86400 * 86400));
+
+    DFO sequential = dfos[0];
+    double sequential_ms = time_ms([&]() { sequential = DFO_Aggregation::aggnto1(dfos, numsamples); });
+    cout << "dfos=" << num_dfos << " numsamples=" << numsamples << "\n";
+    cout << "sequential fold: " << sequential_ms << " ms\n";
+
+    int max_threads = resolve_num_threads(0);
+    for (int threads = 1; threads <= max_threads; threads *= 2) {
+        DFO tree = dfos[0];
+        double tree_ms = time_ms([&]() { tree = DFO_Aggregation::aggnto1_parallel(dfos, numsamples, threads); });
+        cout << "tree reduction, " << threads << " thread(s): " << tree_ms << " ms"
+             << " (speedup " << sequential_ms / tree_ms << "x, max |diff| " << max_abs_difference(sequential, tree) << ")\n";
+        if (threads < max_threads && threads * 2 > max_threads) threads = max_threads / 2; // Always end on max_threads
+    }
+
+    return 0;
+}
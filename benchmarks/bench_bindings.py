@@ -0,0 +1,139 @@
+"""Runs the cases of bench_suite.cpp through the Python bindings, so the numbers include binding overhead
+(argument conversion and result wrapping), and writes results in the same JSON layout.
+
+Build the extension first (python setup.py build_ext --inplace), then from the repository root:
+    python benchmarks/bench_bindings.py [--sizes 100,1000,10000] [--resolutions 3600,900]
+                                        [--cases cluster,start_alignment_aggregate,agg2to1,aggnto1,aggnto1_kway]
+                                        [--rounds 3] [--seed 42] [--out results.json]
+
+Every case is timed like pytest-benchmark does: a number of rounds, reporting min/mean/stddev/max.
+"""
+
+import argparse
+import json
+import math
+import os
+import random
+import sys
+import time
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), ".."))
+import flexoffer_logic as fl  # noqa: E402
+
+DAY_START = 1704067200  # 2024-01-01 00:00 UTC
+GROUP_SIZE = 50
+CASES = ["cluster", "start_alignment_aggregate", "agg2to1", "aggnto1", "aggnto1_kway"]
+
+
+def make_fleet(size, resolution, seed):
+    """Same distribution as make_fleet in bench_suite.cpp (the random streams differ)."""
+    rng = random.Random(seed)
+    slots_per_hour = 3600 // resolution
+    fleet = []
+    for _ in range(size):
+        if rng.random() < 0.7:
+            hour = min(max(rng.gauss(18.0, 2.0), 12.0), 23.0)
+        else:
+            hour = rng.uniform(6.0, 12.0)
+        est = DAY_START + int(hour * 3600) // resolution * resolution
+        lst = est + rng.randint(1, 8) * 3600
+        duration = rng.randint(2, 8) * slots_per_hour
+        power = rng.choice([3.7, 7.4, 11.0])
+        fleet.append((est, lst, duration, power))
+    fleet.sort(key=lambda offer: offer[0])
+    return fleet
+
+
+def to_flexoffer(offer, offer_id, resolution):
+    est, lst, duration, power = offer
+    profile = [fl.TimeSlice(0.0, power) for _ in range(duration)]
+    max_energy = power * duration * resolution / 3600.0
+    return fl.Flexoffer(offer_id, est, lst, lst + duration * resolution, profile, duration,
+                        0.4 * max_energy, 0.8 * max_energy)
+
+
+def to_dfo(offer, dfo_id, resolution):
+    est, _, duration, power = offer
+    slot_energy = power * resolution / 3600.0
+    energy = 0.8 * duration * slot_energy
+    min_prev = [max(0.0, energy - (duration - t) * slot_energy) for t in range(duration + 1)]
+    max_prev = [min(energy, t * slot_energy) for t in range(duration + 1)]
+    dfo = fl.DFO(dfo_id, min_prev, max_prev, 5, slot_energy, -1, -1, est)
+    dfo.generate_dependency_polygons()
+    return dfo
+
+
+def measure(name, size, resolution, rounds, setup, run):
+    times_ms = []
+    for _ in range(rounds):
+        state = setup()
+        start = time.perf_counter()
+        run(state)
+        times_ms.append((time.perf_counter() - start) * 1000.0)
+    mean_ms = sum(times_ms) / len(times_ms)
+    stddev_ms = math.sqrt(sum((t - mean_ms) ** 2 for t in times_ms) / len(times_ms))
+    print(f"{name} size={size} resolution={resolution}: {min(times_ms):.3f} ms (min of {rounds})", file=sys.stderr)
+    return {"case": name, "size": size, "resolution": resolution, "rounds": rounds, "min_ms": min(times_ms),
+            "mean_ms": mean_ms, "stddev_ms": stddev_ms, "max_ms": max(times_ms)}
+
+
+def run_cases(size, resolution, cases, rounds, seed):
+    fl.set_time_resolution(resolution)
+    fleet = make_fleet(size, resolution, seed)
+    offers = [to_flexoffer(offer, i, resolution) for i, offer in enumerate(fleet)]
+    offer_groups = [offers[i:i + GROUP_SIZE] for i in range(0, size, GROUP_SIZE)]
+    dfo_groups = []
+    if any(case.startswith("agg") for case in cases):
+        dfos = [to_dfo(offer, i, resolution) for i, offer in enumerate(fleet)]
+        dfo_groups = [dfos[i:i + GROUP_SIZE] for i in range(0, size, GROUP_SIZE)]
+
+    def singletons():
+        groups = []
+        for i, fo in enumerate(offers):
+            group = fl.Fo_Group(i)
+            group.addFlexOffer(fo)
+            groups.append(group)
+        return groups
+
+    runs = {
+        "cluster": (singletons, lambda groups: fl.clusterFo_Group(groups, 2, 2, GROUP_SIZE)),
+        "start_alignment_aggregate": (lambda: None, lambda _: [fl.start_alignment_aggregate(g) for g in offer_groups]),
+        "agg2to1": (lambda: None, lambda _: [fl.agg2to1(g[k], g[k + 1], 5, resolution)
+                                             for g in dfo_groups for k in range(0, len(g) - 1, 2)]),
+        "aggnto1": (lambda: None, lambda _: [fl.aggnto1(g, 5, resolution) for g in dfo_groups]),
+        "aggnto1_kway": (lambda: None, lambda _: [fl.aggnto1_kway(g, 5, resolution) for g in dfo_groups]),
+    }
+    return [measure(case, size, resolution, rounds, *runs[case]) for case in cases]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--sizes", default="100,1000,10000")
+    parser.add_argument("--resolutions", default="3600,900")
+    parser.add_argument("--cases", default=",".join(CASES))
+    parser.add_argument("--rounds", type=int, default=3)
+    parser.add_argument("--seed", type=int, default=42)
+    parser.add_argument("--out")
+    args = parser.parse_args()
+
+    cases = [case for case in args.cases.split(",") if case]
+    unknown = set(cases) - set(CASES)
+    if unknown:
+        parser.error(f"unknown case(s): {', '.join(sorted(unknown))}")
+
+    fl.set_timezone_offset(0)  # Hours in UTC, so results do not depend on the machine's time zone
+    results = []
+    for resolution in (int(r) for r in args.resolutions.split(",")):
+        for size in (int(float(s)) for s in args.sizes.split(",")):
+            results.extend(run_cases(size, resolution, cases, max(1, args.rounds), args.seed))
+
+    report = {"suite": "python", "hardware_threads": os.cpu_count(), "results": results}
+    if args.out:
+        with open(args.out, "w") as f:
+            json.dump(report, f, indent=2)
+    else:
+        json.dump(report, sys.stdout, indent=2)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,84 @@
+// Compares per-object DFO::generate_dependency_polygons with the batched structure-of-arrays generator.
+//
+// Build (from the repository root):
+//   g++ -O3 -march=native -std=c++14 benchmarks/bench_polygon_batch.cpp src/DFO.cpp src/DFO_batch.cpp src/instrumentation.cpp -o bench_polygon_batch
+// or build the bench_polygon_batch target of benchmarks/CMakeLists.txt.
+// Run:
+//   ./bench_polygon_batch [num_dfos] [numsamples]
+
+#include "../include/DFO.h"
+#include "../include/DFO_batch.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+
+using namespace std;
+
+template <typename F>
+static double time_ms(F&& f) {
+    auto start = chrono::steady_clock::now();
+    f();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    int num_dfos = argc > 1 ? atoi(argv[1]) : 50000;
+    int numsamples = argc > 2 ? atoi(argv[2]) : 5;
+    const double power = 7.3;
+
+    // Synthetic EV charging sessions of 4-10 hours
+    mt19937 rng(42);
+    uniform_int_distribution<int> duration_hours(4, 10);
+    uniform_real_distribution<double> energy_fraction(0.3, 0.9);
+    vector<vector<double>> min_prev(num_dfos), max_prev(num_dfos);
+    for (int d = 0; d < num_dfos; d++) {
+        int duration = duration_hours(rng);
+        double energy = energy_fraction(rng) * duration * power;
+        for (int t = 0; t <= duration; t++) {
+            min_prev[d].push_back(max(0.0, energy - (duration - t) * power));
+            max_prev[d].push_back(min(energy, t * power));
+        }
+    }
+
+    vector<DFO> per_object;
+    double per_object_ms = time_ms([&]() {
+        per_object.reserve(num_dfos);
+        for (int d = 0; d < num_dfos; d++) {
+            per_object.emplace_back(d, min_prev[d], max_prev[d], numsamples, power, -1, -1, 0);
+            per_object.back().generate_dependency_polygons();
+        }
+    });
+
+    DependencyPolygonBatch batch;
+    double batch_ms = time_ms([&]() { batch = generate_dependency_polygons_batch(min_prev, max_prev, numsamples, {power}); });
+
+    vector<int> ids(num_dfos);
+    vector<time_t> starts(num_dfos, 0);
+    for (int d = 0; d < num_dfos; d++) ids[d] = d;
+    vector<DFO> materialized;
+    double materialize_ms = time_ms([&]() { materialized = batch.to_dfos(ids, starts); });
+
+    // Verify the batch produces the same polygons as the per-object path
+    double diff = 0.0;
+    for (int d = 0; d < num_dfos; d++) {
+        const auto& a = per_object[d].polygons;
+        const auto& b = materialized[d].polygons;
+        if (a.size() != b.size()) { diff = INFINITY; break; }
+        for (size_t p = 0; p < a.size(); p++) {
+            if (a[p].points.size() != b[p].points.size()) { diff = INFINITY; break; }
+            for (size_t k = 0; k < a[p].points.size(); k++) {
+                diff = max(diff, fabs(a[p].points[k].x - b[p].points[k].x) + fabs(a[p].points[k].y - b[p].points[k].y));
+            }
+        }
+    }
+
+    cout << "dfos=" << num_dfos << " numsamples=" << numsamples << " polygons=" << batch.num_polygons() << "\n";
+    cout << "per-object generate_dependency_polygons: " << per_object_ms << " ms\n";
+    cout << "batched generation:                      " << batch_ms << " ms (speedup " << per_object_ms / batch_ms << "x)\n";
+    cout << "batched generation + to_dfos:            " << batch_ms + materialize_ms << " ms\n";
+    cout << "max |diff| vs per-object: " << diff << "\n";
+    return 0;
+}
@@ -0,0 +1,249 @@
+// Benchmark suite for the aggregation and clustering hot paths on synthetic fleets, writing JSON results
+// that benchmarks/compare.py can diff between runs. bench_bindings.py runs the same cases through Python.
+//
+// Build (from the repository root):
+//   cmake -S benchmarks -B build/benchmarks && cmake --build build/benchmarks
+// Run:
+//   ./build/benchmarks/bench_suite [--sizes 100,1000,10000,100000] [--resolutions 3600,900]
+//                                  [--cases cluster,start_alignment_aggregate,agg2to1,aggnto1,aggnto1_kway]
+//                                  [--rounds 3] [--seed 42] [--out results.json]
+//
+// Fleet (same distribution as bench_bindings.py): 70% evening EV arrivals around 18:00 (sd 2 h, clipped to
+// 12:00-23:00), 30% daytime arrivals uniform in 06:00-12:00, a start flexibility of 1-8 h and a duration of
+// 2-8 h, all on the resolution grid, charging at 3.7, 7.4 or 11 kW.
+
+#include "../include/DFO.h"
+#include "../include/DFO_aggregation.h"
+#include "../include/clusters.h"
+#include "../include/flexoffer.h"
+#include "../include/groups.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+static const time_t DAY_START = 1704067200; // 2024-01-01 00:00 UTC
+static const int GROUP_SIZE = 50;           // Offers per group for the aggregation cases
+
+struct FleetOffer {
+    time_t est;
+    time_t lst;
+    int duration; // In slots
+    double power;
+};
+
+static vector<FleetOffer> make_fleet(size_t size, int resolution, unsigned seed) {
+    mt19937 rng(seed);
+    bernoulli_distribution evening(0.7);
+    normal_distribution<double> evening_hour(18.0, 2.0);
+    uniform_real_distribution<double> daytime_hour(6.0, 12.0);
+    uniform_int_distribution<int> flexibility_hours(1, 8);
+    uniform_int_distribution<int> duration_hours(2, 8);
+    const double powers[] = {3.7, 7.4, 11.0};
+    uniform_int_distribution<int> power_index(0, 2);
+
+    int slots_per_hour = 3600 / resolution;
+    vector<FleetOffer> fleet(size);
+    for (FleetOffer& offer : fleet) {
+        double hour = evening(rng) ? min(max(evening_hour(rng), 12.0), 23.0) : daytime_hour(rng);
+        offer.est = DAY_START + static_cast<time_t>(hour * 3600) / resolution * resolution;
+        offer.lst = offer.est + flexibility_hours(rng) * 3600;
+        offer.duration = duration_hours(rng) * slots_per_hour;
+        offer.power = powers[power_index(rng)];
+    }
+    return fleet;
+}
+
+static Flexoffer to_flexoffer(const FleetOffer& offer, int id, int resolution) {
+    vector<TimeSlice> profile(offer.duration, TimeSlice(0.0, offer.power));
+    double max_energy = offer.power * offer.duration * resolution / 3600.0;
+    return Flexoffer(id, offer.est, offer.lst, offer.lst + offer.duration * resolution, profile, offer.duration,
+                     0.4 * max_energy, 0.8 * max_energy);
+}
+
+// Charging session needing 80% of the energy the slots allow, as in bench_aggnto1.cpp
+static DFO to_dfo(const FleetOffer& offer, int id, int resolution) {
+    double slot_energy = offer.power * resolution / 3600.0;
+    double energy = 0.8 * offer.duration * slot_energy;
+    vector<double> min_prev, max_prev;
+    for (int t = 0; t <= offer.duration; t++) {
+        min_prev.push_back(max(0.0, energy - (offer.duration - t) * slot_energy));
+        max_prev.push_back(min(energy, t * slot_energy));
+    }
+    DFO dfo(id, min_prev, max_prev, 5, slot_energy, -1, -1, offer.est);
+    dfo.generate_dependency_polygons();
+    return dfo;
+}
+
+struct Result {
+    string name;
+    size_t size;
+    int resolution;
+    vector<double> times_ms;
+};
+
+template <typename Setup, typename Run>
+static Result measure(const string& name, size_t size, int resolution, int rounds, Setup setup, Run run) {
+    Result result{name, size, resolution, {}};
+    for (int r = 0; r < rounds; r++) {
+        auto state = setup(); // Not timed, e.g. a fresh copy of the input for cases that modify it
+        auto start = chrono::steady_clock::now();
+        run(state);
+        result.times_ms.push_back(chrono::duration<double, milli>(chrono::steady_clock::now() - start).count());
+    }
+    return result;
+}
+
+// Times run on one group of GROUP_SIZE neighbouring offers at a time, summing the times of each round over
+// all groups. Only one group's inputs exist at once, which keeps fleets of 10^6 DFOs within memory.
+template <typename MakeGroup, typename Run>
+static Result measure_groups(const string& name, const vector<FleetOffer>& fleet, int resolution, int rounds,
+                             MakeGroup make_group, Run run) {
+    Result result{name, fleet.size(), resolution, vector<double>(rounds, 0.0)};
+    for (size_t first = 0; first < fleet.size(); first += GROUP_SIZE) {
+        auto group = make_group(first, min(fleet.size(), first + GROUP_SIZE));
+        for (int r = 0; r < rounds; r++) {
+            auto start = chrono::steady_clock::now();
+            run(group);
+            result.times_ms[r] += chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        }
+    }
+    return result;
+}
+
+static vector<string> split(const string& text) {
+    vector<string> parts;
+    stringstream stream(text);
+    string part;
+    while (getline(stream, part, ',')) {
+        if (!part.empty()) parts.push_back(part);
+    }
+    return parts;
+}
+
+static void write_json(ostream& out, const vector<Result>& results) {
+    out << "{\n  \"suite\": \"cpp\",\n  \"hardware_threads\": " << thread::hardware_concurrency() << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        double min_ms = *min_element(r.times_ms.begin(), r.times_ms.end());
+        double max_ms = *max_element(r.times_ms.begin(), r.times_ms.end());
+        double mean_ms = 0.0, variance = 0.0;
+        for (double t : r.times_ms) mean_ms += t / r.times_ms.size();
+        for (double t : r.times_ms) variance += (t - mean_ms) * (t - mean_ms) / r.times_ms.size();
+        out << (i ? "," : "") << "\n    {\"case\": \"" << r.name << "\", \"size\": " << r.size
+            << ", \"resolution\": " << r.resolution << ", \"rounds\": " << r.times_ms.size()
+            << ", \"min_ms\": " << min_ms << ", \"mean_ms\": " << mean_ms
+            << ", \"stddev_ms\": " << sqrt(variance) << ", \"max_ms\": " << max_ms << "}";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes = {100, 1000, 10000, 100000};
+    vector<int> resolutions = {3600, 900};
+    vector<string> cases = {"cluster", "start_alignment_aggregate", "agg2to1", "aggnto1", "aggnto1_kway"};
+    int rounds = 3;
+    unsigned seed = 42;
+    string out_path;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        string flag = argv[i], value = argv[i + 1];
+        if (flag == "--sizes") {
+            sizes.clear();
+            for (const string& s : split(value)) sizes.push_back(static_cast<size_t>(atof(s.c_str())));
+        } else if (flag == "--resolutions") {
+            resolutions.clear();
+            for (const string& s : split(value)) resolutions.push_back(atoi(s.c_str()));
+        } else if (flag == "--cases") {
+            cases = split(value);
+        } else if (flag == "--rounds") {
+            rounds = max(1, atoi(value.c_str()));
+        } else if (flag == "--seed") {
+            seed = static_cast<unsigned>(atoi(value.c_str()));
+        } else if (flag == "--out") {
+            out_path = value;
+        } else {
+            cerr << "unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    set_timezone_offset(0); // Hours in UTC, so results do not depend on the machine's time zone
+    vector<Result> results;
+
+    for (int resolution : resolutions) {
+        set_time_resolution(resolution);
+        for (size_t size : sizes) {
+            vector<FleetOffer> fleet = make_fleet(size, resolution, seed);
+            sort(fleet.begin(), fleet.end(), [](const FleetOffer& a, const FleetOffer& b) { return a.est < b.est; });
+
+            // Groups of neighbouring offers stand in for the output of clustering in the aggregation cases
+            auto make_offers = [&](size_t first, size_t last) {
+                vector<Flexoffer> offers;
+                for (size_t i = first; i < last; i++) offers.push_back(to_flexoffer(fleet[i], static_cast<int>(i), resolution));
+                return offers;
+            };
+            auto make_dfos = [&](size_t first, size_t last) {
+                vector<DFO> dfos;
+                for (size_t i = first; i < last; i++) dfos.push_back(to_dfo(fleet[i], static_cast<int>(i), resolution));
+                return dfos;
+            };
+
+            for (const string& name : cases) {
+                Result result;
+                if (name == "cluster") {
+                    auto singletons = [&]() {
+                        vector<Fo_Group> groups;
+                        groups.reserve(size);
+                        for (size_t i = 0; i < size; i++) {
+                            groups.emplace_back(static_cast<int>(i));
+                            groups.back().addFlexOffer(to_flexoffer(fleet[i], static_cast<int>(i), resolution));
+                        }
+                        return groups;
+                    };
+                    result = measure(name, size, resolution, rounds, singletons,
+                                     [](vector<Fo_Group>& groups) { clusterFo_Group(groups, 2, 2, GROUP_SIZE); });
+                } else if (name == "start_alignment_aggregate") {
+                    result = measure_groups(name, fleet, resolution, rounds, make_offers,
+                                            [](const vector<Flexoffer>& offers) { start_alignment_aggregate(offers); });
+                } else if (name == "agg2to1") {
+                    result = measure_groups(name, fleet, resolution, rounds, make_dfos, [&](const vector<DFO>& dfos) {
+                        for (size_t k = 0; k + 1 < dfos.size(); k += 2) DFO_Aggregation::agg2to1(dfos[k], dfos[k + 1], 5, resolution);
+                    });
+                } else if (name == "aggnto1") {
+                    result = measure_groups(name, fleet, resolution, rounds, make_dfos,
+                                            [&](const vector<DFO>& dfos) { DFO_Aggregation::aggnto1(dfos, 5, resolution); });
+                } else if (name == "aggnto1_kway") {
+                    result = measure_groups(name, fleet, resolution, rounds, make_dfos,
+                                            [&](const vector<DFO>& dfos) { DFO_Aggregation::aggnto1_kway(dfos, 5, resolution); });
+                } else {
+                    cerr << "unknown case " << name << "\n";
+                    return 1;
+                }
+                cerr << name << " size=" << size << " resolution=" << resolution << ": "
+                     << *min_element(result.times_ms.begin(), result.times_ms.end()) << " ms (min of " << rounds << ")\n";
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (out_path.empty()) {
+        write_json(cout, results);
+    } else {
+        ofstream out(out_path);
+        write_json(out, results);
+    }
+    return 0;
+}
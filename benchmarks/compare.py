@@ -0,0 +1,36 @@
+"""Compares two benchmark result files written by bench_suite or bench_bindings.py.
+
+    python benchmarks/compare.py baseline.json candidate.json [--threshold 0.05]
+
+Prints the change in mean time for every case, size and resolution found in both files, marking
+changes larger than the threshold as faster or slower.
+"""
+
+import argparse
+import json
+
+
+def load(path):
+    with open(path) as f:
+        report = json.load(f)
+    return {(r["case"], r["size"], r["resolution"]): r for r in report["results"]}
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("baseline")
+    parser.add_argument("candidate")
+    parser.add_argument("--threshold", type=float, default=0.05, help="relative change to flag (default 5%%)")
+    args = parser.parse_args()
+
+    baseline, candidate = load(args.baseline), load(args.candidate)
+    print(f"{'case':<28}{'size':>9}{'res':>6}{'baseline ms':>14}{'candidate ms':>14}{'change':>9}")
+    for key in sorted(baseline.keys() & candidate.keys()):
+        before, after = baseline[key]["mean_ms"], candidate[key]["mean_ms"]
+        change = (after - before) / before if before > 0 else 0.0
+        verdict = "" if abs(change) <= args.threshold else ("  faster" if change < 0 else "  slower")
+        print(f"{key[0]:<28}{key[1]:>9}{key[2]:>6}{before:>14.3f}{after:>14.3f}{change:>+9.1%}{verdict}")
+
+
+if __name__ == "__main__":
+    main()
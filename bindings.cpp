@@ -1,10 +1,47 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 
+#include "include/alignment.h"
 #include "include/clusters.h"
 #include "include/helpers.h"
 #include "include/DFO.h"
 #include "include/DFO_aggregation.h"
+#include "include/DFO_batch.h"
+#include "include/DFO_optimizer.h"
+#include "include/flexibility.h"
+#include "include/flexoffer_batch.h"
+#include "include/flexoffer_reader.h"
+#include "include/incremental_aggregate.h"
+#include "include/instrumentation.h"
+#include "include/online_clusterer.h"
+#include "include/resolution.h"
+#include "include/scheduler.h"
+#include "include/serialization.h"
+
+namespace py = pybind11;
+
+// Copies a 1-D NumPy array into a vector with a single bulk copy
+template <typename T>
+static std::vector<T> array_to_vector(const py::array_t<T, py::array::c_style | py::array::forcecast>& values) {
+    if (values.ndim() != 1) throw std::invalid_argument("expected a 1-D array");
+    return std::vector<T>(values.data(), values.data() + values.size());
+}
+
+// Read-only NumPy view (no copy) of a vector owned by the Python object `owner`
+template <typename T>
+static py::array_t<T> readonly_view(const std::vector<T>& values, py::object owner) {
+    py::array_t<T> view({static_cast<py::ssize_t>(values.size())}, {static_cast<py::ssize_t>(sizeof(T))}, values.data(), owner);
+    view.attr("setflags")(py::arg("write") = false);
+    return view;
+}
+
+// Pickle state of a single object is a one item binary snapshot
+template <typename T>
+T single_from_snapshot(std::vector<T> items) {
+    if (items.size() != 1) throw std::runtime_error("pickle state must hold exactly one object");
+    return std::move(items[0]);
+}
 
 PYBIND11_MODULE(flexoffer_logic, m) {
     pybind11::class_<TimeSlice>(m, "TimeSlice")
@@ -29,12 +66,81 @@ PYBIND11_MODULE(flexoffer_logic, m) {
         .def("get_scheduled_start_time", &Flexoffer::get_scheduled_start_time)
         .def("set_scheduled_allocation", &Flexoffer::set_scheduled_allocation)
         .def("set_scheduled_start_time", &Flexoffer::set_scheduled_start_time)
+        .def("get_profile_min_power_array", [](pybind11::object self) {
+            auto& profile = self.cast<Flexoffer&>().get_profile_ref();
+            return py::array_t<double>({static_cast<py::ssize_t>(profile.size())}, {static_cast<py::ssize_t>(sizeof(TimeSlice))},
+                                       profile.empty() ? nullptr : &profile[0].min_power, self);
+        }, "Writable NumPy view (no copy) of the profile's min_power, valid while the Flexoffer lives")
+        .def("get_profile_max_power_array", [](pybind11::object self) {
+            auto& profile = self.cast<Flexoffer&>().get_profile_ref();
+            return py::array_t<double>({static_cast<py::ssize_t>(profile.size())}, {static_cast<py::ssize_t>(sizeof(TimeSlice))},
+                                       profile.empty() ? nullptr : &profile[0].max_power, self);
+        }, "Writable NumPy view (no copy) of the profile's max_power, valid while the Flexoffer lives")
+        .def("get_scheduled_allocation_array", [](pybind11::object self) {
+            auto& allocation = self.cast<Flexoffer&>().get_scheduled_allocation_ref();
+            return py::array_t<double>({static_cast<py::ssize_t>(allocation.size())}, {static_cast<py::ssize_t>(sizeof(double))},
+                                       allocation.data(), self);
+        }, "Writable NumPy view (no copy) of the scheduled allocation; a set_scheduled_allocation of another length invalidates it")
+        .def("set_scheduled_allocation_array", [](Flexoffer& fo, py::array_t<double, py::array::c_style | py::array::forcecast> values) {
+            if (values.ndim() != 1) throw std::invalid_argument("scheduled allocation must be a 1-D array");
+            fo.assign_scheduled_allocation(values.data(), static_cast<size_t>(values.size()));
+        }, "Set the scheduled allocation from a NumPy array with one bulk copy", pybind11::arg("values"))
         .def("print_flexoffer", &Flexoffer::print_flexoffer)
         .def("get_est_hour", &Flexoffer::get_est_hour)
         .def("get_lst_hour", &Flexoffer::get_lst_hour)
         .def("get_et_hour", &Flexoffer::get_et_hour)
-        .def("get_total_energy", &Flexoffer::get_total_energy);
+        .def("get_total_energy", &Flexoffer::get_total_energy)
+        .def(py::pickle(
+            [](const Flexoffer& fo) { return py::bytes(serialize_flexoffers({fo})); },
+            [](const py::bytes& state) { return single_from_snapshot(deserialize_flexoffers(state)); }));
     
+    pybind11::class_<FlexofferBatch>(m, "FlexofferBatch")
+        .def(pybind11::init<>())
+        .def(pybind11::init([](py::array_t<int, py::array::c_style | py::array::forcecast> offer_ids,
+                               py::array_t<time_t, py::array::c_style | py::array::forcecast> earliest_start,
+                               py::array_t<time_t, py::array::c_style | py::array::forcecast> latest_start,
+                               py::array_t<time_t, py::array::c_style | py::array::forcecast> end_time,
+                               py::array_t<int, py::array::c_style | py::array::forcecast> duration,
+                               py::array_t<size_t, py::array::c_style | py::array::forcecast> profile_offsets,
+                               py::array_t<double, py::array::c_style | py::array::forcecast> min_power,
+                               py::array_t<double, py::array::c_style | py::array::forcecast> max_power,
+                               py::array_t<double, py::array::c_style | py::array::forcecast> min_overall_alloc,
+                               py::array_t<double, py::array::c_style | py::array::forcecast> max_overall_alloc) {
+                 return FlexofferBatch(array_to_vector(offer_ids), array_to_vector(earliest_start), array_to_vector(latest_start),
+                                       array_to_vector(end_time), array_to_vector(duration), array_to_vector(profile_offsets),
+                                       array_to_vector(min_power), array_to_vector(max_power),
+                                       array_to_vector(min_overall_alloc), array_to_vector(max_overall_alloc));
+             }),
+             pybind11::arg("offer_ids"), pybind11::arg("earliest_start"), pybind11::arg("latest_start"),
+             pybind11::arg("end_time"), pybind11::arg("duration"), pybind11::arg("profile_offsets"),
+             pybind11::arg("min_power"), pybind11::arg("max_power"),
+             pybind11::arg("min_overall_alloc") = py::array_t<double>(0), pybind11::arg("max_overall_alloc") = py::array_t<double>(0))
+        .def_static("from_flexoffers", &FlexofferBatch::from_flexoffers, pybind11::arg("flex_offers"))
+        .def_property_readonly("offer_ids", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().offer_ids, self); })
+        .def_property_readonly("earliest_start", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().earliest_start, self); })
+        .def_property_readonly("latest_start", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().latest_start, self); })
+        .def_property_readonly("end_time", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().end_time, self); })
+        .def_property_readonly("duration", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().duration, self); })
+        .def_property_readonly("profile_offsets", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().profile_offsets, self); })
+        .def_property_readonly("min_power", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().min_power, self); })
+        .def_property_readonly("max_power", [](py::object self) { return readonly_view(self.cast<FlexofferBatch&>().max_power, self); })
+        .def("__len__", &FlexofferBatch::size)
+        .def("add", &FlexofferBatch::add, pybind11::arg("flexoffer"))
+        .def("to_flexoffer", &FlexofferBatch::to_flexoffer, pybind11::arg("index"))
+        .def("to_flexoffers", &FlexofferBatch::to_flexoffers)
+        .def("get_offer_id", &FlexofferBatch::get_offer_id, pybind11::arg("index"))
+        .def("get_est", &FlexofferBatch::get_est, pybind11::arg("index"))
+        .def("get_lst", &FlexofferBatch::get_lst, pybind11::arg("index"))
+        .def("get_et", &FlexofferBatch::get_et, pybind11::arg("index"))
+        .def("get_duration", &FlexofferBatch::get_duration, pybind11::arg("index"))
+        .def("get_profile", &FlexofferBatch::get_profile, pybind11::arg("index"))
+        .def("get_est_hour", &FlexofferBatch::get_est_hour, pybind11::arg("index"))
+        .def("get_lst_hour", &FlexofferBatch::get_lst_hour, pybind11::arg("index"))
+        .def("get_total_energy", &FlexofferBatch::get_total_energy, pybind11::arg("index"))
+        .def(py::pickle(
+            [](const FlexofferBatch& batch) { return py::bytes(serialize_flexoffer_batch(batch)); },
+            [](const py::bytes& state) { return deserialize_flexoffer_batch(state); }));
+
     pybind11::class_<Point>(m, "Point")
         .def(py::init<double, double>())
         .def_readwrite("x", &Point::x)
@@ -67,32 +173,330 @@ PYBIND11_MODULE(flexoffer_logic, m) {
         .def_readwrite("latest_start", &DFO::latest_start)
         .def_readwrite("polygons", &DFO::polygons)
         .def("generate_dependency_polygons", &DFO::generate_dependency_polygons)
-        .def("__repr__", &DFO::to_string);
+        .def("__repr__", &DFO::to_string)
+        .def(py::pickle(
+            [](const DFO& dfo) { return py::bytes(serialize_dfos({dfo})); },
+            [](const py::bytes& state) { return single_from_snapshot(deserialize_dfos(state)); }));
+
+    pybind11::class_<DependencyPolygonBatch>(m, "DependencyPolygonBatch")
+        .def_readonly("numsamples", &DependencyPolygonBatch::numsamples)
+        .def_readonly("dfo_offsets", &DependencyPolygonBatch::dfo_offsets)
+        .def_readonly("min_prev_energy", &DependencyPolygonBatch::min_prev_energy)
+        .def_readonly("max_prev_energy", &DependencyPolygonBatch::max_prev_energy)
+        .def_readonly("x", &DependencyPolygonBatch::x)
+        .def_readonly("y_min", &DependencyPolygonBatch::y_min)
+        .def_readonly("y_max", &DependencyPolygonBatch::y_max)
+        .def("num_dfos", &DependencyPolygonBatch::num_dfos)
+        .def("num_polygons", &DependencyPolygonBatch::num_polygons)
+        .def("to_dfo", &DependencyPolygonBatch::to_dfo,
+             pybind11::arg("index"), pybind11::arg("dfo_id"), pybind11::arg("earliest_start"))
+        .def("to_dfos", &DependencyPolygonBatch::to_dfos,
+             pybind11::arg("dfo_ids"), pybind11::arg("earliest_starts"));
+
+    m.def("generate_dependency_polygons_batch", &generate_dependency_polygons_batch,
+        "Generate the dependency polygons of many DFOs at once in structure-of-arrays layout",
+        pybind11::arg("min_prev"), py::arg("max_prev"), py::arg("numsamples") = 5,
+        py::arg("charging_power") = std::vector<double>{7.3},
+        py::call_guard<py::gil_scoped_release>());
 
     m.def("agg2to1", &DFO_Aggregation::agg2to1, "Aggregate two DFOs into one, accounting for different start times",
-        pybind11::arg("dfo1"), py::arg("dfo2"), py::arg("numsamples"));
+        pybind11::arg("dfo1"), py::arg("dfo2"), py::arg("numsamples"), py::arg("resolution") = 3600);
   
     m.def("aggnto1", &DFO_Aggregation::aggnto1, "Aggregate multiple DFOs into one, accounting for different start times",
-        pybind11::arg("dfos"), py::arg("numsamples"));
+        pybind11::arg("dfos"), py::arg("numsamples"), py::arg("resolution") = 3600);
+
+    m.def("aggnto1_kway", &DFO_Aggregation::aggnto1_kway,
+        "Aggregate multiple DFOs into one in a single sweep over a common timeline, without intermediate DFOs",
+        pybind11::arg("dfos"), py::arg("numsamples"), py::arg("resolution") = 3600);
+
+    m.def("disaggregate_dfo", &DFO_Aggregation::disaggregate,
+        "Split an aggregated DFO's energy trajectory into member trajectories that stay within the interpolated bounds of "
+        "their dependency polygons, one list per member DFO; raises ValueError if no such split is found",
+        pybind11::arg("dfos"), py::arg("aggregate_usage"), py::arg("resolution") = 3600,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("aggnto1_parallel", &DFO_Aggregation::aggnto1_parallel,
+        "Aggregate multiple DFOs into one using a pairwise (tree) reduction on a thread pool, releasing the GIL",
+        pybind11::arg("dfos"), py::arg("numsamples"), py::arg("num_threads") = 0, py::arg("resolution") = 3600,
+        py::call_guard<py::gil_scoped_release>());
   
-    m.def("find_or_interpolate_points", &DFO_Aggregation::find_or_interpolate_points, 
+    m.def("coarsen_dfo", &coarsen_dfo,
+        "Coarsen a DFO from resolution to coarse_resolution seconds per timestep (a multiple of resolution)",
+        pybind11::arg("dfo"), py::arg("resolution"), py::arg("coarse_resolution"));
+
+    m.def("coarsen_dfos", &coarsen_dfos, "Coarsen many DFOs in parallel with the GIL released",
+        pybind11::arg("dfos"), py::arg("resolution"), py::arg("coarse_resolution"), py::arg("num_threads") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("coarsen_flexoffer", &coarsen_flexoffer,
+        "Coarsen a Flexoffer from resolution to coarse_resolution seconds per slot (a multiple of resolution)",
+        pybind11::arg("flexoffer"), py::arg("resolution"), py::arg("coarse_resolution"));
+
+    m.def("coarsen_flexoffers", &coarsen_flexoffers, "Coarsen many Flexoffers in parallel with the GIL released",
+        pybind11::arg("flexoffers"), py::arg("resolution"), py::arg("coarse_resolution"), py::arg("num_threads") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("refine_flexoffer_schedule", [](const Flexoffer& coarse, Flexoffer fine, int resolution, int coarse_resolution) {
+            refine_flexoffer_schedule(coarse, fine, resolution, coarse_resolution);
+            return fine;
+        }, "Spread the schedule of a coarsened Flexoffer over the fine one and return the scheduled fine Flexoffer",
+        pybind11::arg("coarse"), py::arg("fine"), py::arg("resolution"), py::arg("coarse_resolution"));
+
+    m.def("schedule_flexoffer", [](Flexoffer fo, const std::vector<double>& prices, time_t price_start, int resolution) {
+            double cost = schedule_flexoffer(fo, prices, price_start, resolution);
+            return py::make_tuple(fo, cost);
+        }, "Schedule a Flexoffer at its cheapest start for the given prices per slot; returns (scheduled offer, cost)",
+        pybind11::arg("flexoffer"), py::arg("prices"), py::arg("price_start"), py::arg("resolution") = 0);
+
+    m.def("schedule_flexoffers", [](std::vector<Flexoffer> flex_offers, const std::vector<double>& prices, time_t price_start,
+                                    int resolution, int num_threads) {
+            std::vector<double> costs;
+            {
+                py::gil_scoped_release release;
+                costs = schedule_flexoffers(flex_offers, prices, price_start, resolution, num_threads);
+            }
+            return py::make_tuple(flex_offers, costs);
+        }, "Schedule many Flexoffers in parallel with the GIL released; returns (scheduled offers, cost per offer)",
+        pybind11::arg("flex_offers"), py::arg("prices"), py::arg("price_start"), py::arg("resolution") = 0,
+        py::arg("num_threads") = 0);
+
+    pybind11::class_<DFOSchedule>(m, "DFOSchedule")
+        .def_readonly("usage", &DFOSchedule::usage)
+        .def_readonly("cost", &DFOSchedule::cost);
+
+    m.def("optimize_dfo", &optimize_dfo,
+        "Cost-minimal energy trajectory through a DFO's polygons for prices per timestep from price_start (dynamic programming)",
+        pybind11::arg("dfo"), py::arg("prices"), py::arg("price_start"), py::arg("resolution") = 3600,
+        py::arg("num_states") = 201,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("optimize_dfos", &optimize_dfos, "optimize_dfo for many DFOs in parallel with the GIL released",
+        pybind11::arg("dfos"), py::arg("prices"), py::arg("price_start"), py::arg("resolution") = 3600,
+        py::arg("num_states") = 201, py::arg("num_threads") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("find_or_interpolate_points", &DFO_Aggregation::findOrInterpolatePoints, 
         "Finds or interpolate points for a given dependency value",
         pybind11::arg("points"), py::arg("dependency_value"));
 
+    pybind11::class_<IncrementalAggregate>(m, "IncrementalAggregate")
+        .def(pybind11::init<int>(), pybind11::arg("resolution") = 0)
+        .def("add", &IncrementalAggregate::add, pybind11::arg("flexoffer"))
+        .def("remove", &IncrementalAggregate::remove, pybind11::arg("offer_id"))
+        .def("contains", &IncrementalAggregate::contains, pybind11::arg("offer_id"))
+        .def("__len__", &IncrementalAggregate::size)
+        .def("aggregate", &IncrementalAggregate::aggregate);
+
+    pybind11::class_<OnlineClusterer>(m, "OnlineClusterer")
+        .def(pybind11::init<int, int, int>(),
+             pybind11::arg("est_threshold"), py::arg("lst_threshold"), py::arg("max_group_size"))
+        .def("insert", &OnlineClusterer::insert, pybind11::arg("flexoffer"))
+        .def("insert_many", &OnlineClusterer::insert_many, pybind11::arg("flexoffers"),
+             py::call_guard<py::gil_scoped_release>())
+        .def("remove", &OnlineClusterer::remove, pybind11::arg("offer_id"))
+        .def("remove_expired", &OnlineClusterer::remove_expired, pybind11::arg("now"))
+        .def("take_changed_groups", &OnlineClusterer::take_changed_groups)
+        .def("contains", &OnlineClusterer::contains, pybind11::arg("offer_id"))
+        .def("has_group", &OnlineClusterer::has_group, pybind11::arg("group_id"))
+        .def("group_of", &OnlineClusterer::group_of, pybind11::arg("offer_id"))
+        .def("get_group", &OnlineClusterer::get_group, pybind11::arg("group_id"))
+        .def("get_groups", &OnlineClusterer::get_groups)
+        .def("num_groups", &OnlineClusterer::num_groups)
+        .def("__len__", &OnlineClusterer::size);
+
     pybind11::class_<Fo_Group>(m, "Fo_Group")
         .def(pybind11::init<int>()) 
-        .def("getFlexOffers", &Fo_Group::getFlexOffers)
-        .def("addFlexOffer", &Fo_Group::addFlexOffer);
+        .def("getFlexOffers", static_cast<const std::vector<Flexoffer>& (Fo_Group::*)() const>(&Fo_Group::getFlexOffers))
+        .def("addFlexOffer", &Fo_Group::addFlexOffer)
+        .def(py::pickle(
+            [](const Fo_Group& group) { return py::bytes(serialize_groups({group})); },
+            [](const py::bytes& state) { return single_from_snapshot(deserialize_groups(state)); }));
 
-    m.def("clusterFo_Group", &clusterFo_Group, "Clusters a vector of Fo_Group",
+    m.def("clusterFo_Group", [](std::vector<Fo_Group> groups, int est_threshold, int lst_threshold, int max_group_size) {
+            clusterFo_Group(groups, est_threshold, lst_threshold, max_group_size);
+            return groups;
+        }, "Clusters a vector of Fo_Group and returns the resulting groups",
         pybind11::arg("groups"), pybind11::arg("est_threshold"),
         pybind11::arg("lst_threshold"),
         pybind11::arg("max_group_size"));
 
+    m.def("clusterFo_Group_partitioned", [](std::vector<Fo_Group> groups, int est_threshold, int lst_threshold,
+                                            int max_group_size, int num_threads) {
+            clusterFo_Group_partitioned(groups, est_threshold, lst_threshold, max_group_size, num_threads);
+            return groups;
+        }, "Clusters independent partitions of a vector of Fo_Group in parallel and returns the resulting groups",
+        pybind11::arg("groups"), pybind11::arg("est_threshold"),
+        pybind11::arg("lst_threshold"),
+        pybind11::arg("max_group_size"), pybind11::arg("num_threads") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("set_timezone_offset", &set_timezone_offset,
+        "Derive Flexoffer hours at a fixed offset from UTC (in seconds) instead of the system time zone; set before creating Flexoffers",
+        pybind11::arg("offset_seconds"));
+
+    m.def("use_local_timezone", &use_local_timezone, "Derive Flexoffer hours in the system time zone (default)");
+
+    m.def("clusterFlexofferBatch", &clusterFlexofferBatch,
+        "Clusters the offers of a FlexofferBatch like clusterFo_Group on singleton groups, returning offer indices per group",
+        pybind11::arg("batch"), pybind11::arg("est_threshold"),
+        pybind11::arg("lst_threshold"),
+        pybind11::arg("max_group_size"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("time_flexibility", &time_flexibility, "LST - EST of a Flexoffer in slots",
+        pybind11::arg("flexoffer"), pybind11::arg("resolution") = 0);
+    m.def("energy_flexibility", &energy_flexibility, "Sum of max_power - min_power over the profile in kWh",
+        pybind11::arg("flexoffer"), pybind11::arg("resolution") = 0);
+    m.def("absolute_area", &absolute_area, "Area between the power envelopes of all starts in [EST, LST] in kWh",
+        pybind11::arg("flexoffer"), pybind11::arg("resolution") = 0);
+
+    pybind11::class_<FlexibilityLoss>(m, "FlexibilityLoss")
+        .def("__len__", &FlexibilityLoss::size)
+        .def_property_readonly("time_flex_loss", [](py::object self) { return readonly_view(self.cast<FlexibilityLoss&>().time_flex_loss, self); })
+        .def_property_readonly("energy_flex_loss", [](py::object self) { return readonly_view(self.cast<FlexibilityLoss&>().energy_flex_loss, self); })
+        .def_property_readonly("area_loss", [](py::object self) { return readonly_view(self.cast<FlexibilityLoss&>().area_loss, self); });
+
+    m.def("flexibility_loss_groups", &flexibility_loss_groups,
+        "Time, energy and area flexibility lost per group by aggregation (start alignment if no aggregates are given)",
+        pybind11::arg("groups"), pybind11::arg("aggregates") = std::vector<Flexoffer>{}, pybind11::arg("num_threads") = 0,
+        pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("flexibility_loss_batch", &flexibility_loss_batch,
+        "Time, energy and area flexibility lost per cluster of clusterFlexofferBatch by start alignment aggregation",
+        pybind11::arg("batch"), pybind11::arg("clusters"), pybind11::arg("num_threads") = 0, pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("get_time_resolution", &get_time_resolution, "get the time resolution used by the c++ logic");
+
     m.def("set_time_resolution", &set_time_resolution, "set time resolution in c++ logic (should be equal to python)",
         pybind11::arg("resolution"));
 
     m.def("start_alignment_aggregate", &start_alignment_aggregate, "Aggregate FlexOffers using start alignment.",
-        pybind11::arg("flex_offers"));
-}
+        pybind11::arg("flex_offers"), pybind11::arg("resolution") = 0);
+
+    m.def("start_alignment_aggregate_groups", &start_alignment_aggregate_groups,
+        "Aggregate every Fo_Group using start alignment, in parallel with the GIL released.",
+        pybind11::arg("groups"), pybind11::arg("num_threads") = 0, pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("disaggregate_start_aligned", [](const Flexoffer& aggregate, std::vector<Flexoffer> members, int resolution) {
+            disaggregate_start_aligned(aggregate, members, resolution);
+            return members;
+        }, "Split the schedule of a start alignment aggregate over its members and return the scheduled members.",
+        pybind11::arg("aggregate"), pybind11::arg("members"), pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    pybind11::class_<AlignedAggregate>(m, "AlignedAggregate")
+        .def_readonly("aggregate", &AlignedAggregate::aggregate)
+        .def_readonly("shifts", &AlignedAggregate::shifts);
+
+    m.def("balance_alignment_aggregate", &balance_alignment_aggregate,
+        "Aggregate FlexOffers, shifting each member within its time flexibility to flatten the aggregate profile.",
+        pybind11::arg("flex_offers"), pybind11::arg("resolution") = 0);
+
+    m.def("best_shift_aggregate", &best_shift_aggregate,
+        "Aggregate FlexOffers, searching the best shift of every member while keeping the start alignment time flexibility "
+        "up to max_flexibility_loss slots.",
+        pybind11::arg("flex_offers"), pybind11::arg("max_flexibility_loss") = 0, pybind11::arg("max_passes") = 4,
+        pybind11::arg("resolution") = 0);
+
+    m.def("disaggregate_aligned", [](const Flexoffer& aggregate, const std::vector<int>& shifts, std::vector<Flexoffer> members,
+                                     int resolution) {
+            disaggregate_aligned(aggregate, shifts, members, resolution);
+            return members;
+        }, "Split the schedule of a shifted aggregate over its members and return the scheduled members.",
+        pybind11::arg("aggregate"), pybind11::arg("shifts"), pybind11::arg("members"), pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("disaggregate_groups", &disaggregate_groups,
+        "Disaggregate the schedule of every aggregate into its group, in parallel with the GIL released; returns the scheduled groups.",
+        pybind11::arg("aggregates"), pybind11::arg("groups"), pybind11::arg("num_threads") = 0, pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("start_alignment_aggregate_batch", &start_alignment_aggregate_batch,
+        "Aggregate the offers of a FlexofferBatch at the given indices (all if empty) using start alignment.",
+        pybind11::arg("batch"), pybind11::arg("indices") = std::vector<int>(), pybind11::arg("resolution") = 0,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("save_flexoffers", &save_flexoffers, "Write Flexoffers to a versioned binary snapshot file.",
+        pybind11::arg("path"), pybind11::arg("flex_offers"),
+        py::call_guard<py::gil_scoped_release>());
 
+    m.def("load_flexoffers", &load_flexoffers, "Read Flexoffers from a binary snapshot file.",
+        pybind11::arg("path"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("load_flexoffer_batch", &load_flexoffer_batch, "Read a binary snapshot file of Flexoffers straight into a FlexofferBatch.",
+        pybind11::arg("path"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("save_dfos", &save_dfos, "Write DFOs to a versioned binary snapshot file.",
+        pybind11::arg("path"), pybind11::arg("dfos"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("load_dfos", &load_dfos, "Read DFOs from a binary snapshot file.",
+        pybind11::arg("path"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("save_groups", &save_groups, "Write Fo_Groups to a versioned binary snapshot file.",
+        pybind11::arg("path"), pybind11::arg("groups"),
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("load_groups", &load_groups, "Read Fo_Groups from a binary snapshot file.",
+        pybind11::arg("path"),
+        py::call_guard<py::gil_scoped_release>());
+
+    pybind11::class_<FlexofferParseError>(m, "FlexofferParseError")
+        .def_readonly("line", &FlexofferParseError::line)
+        .def_readonly("message", &FlexofferParseError::message)
+        .def("__repr__", [](const FlexofferParseError& error) {
+            return "line " + std::to_string(error.line) + ": " + error.message;
+        });
+
+    pybind11::class_<FlexofferReader>(m, "FlexofferReader")
+        .def(pybind11::init<const std::string&, const std::string&, size_t, int>(),
+             pybind11::arg("path"), pybind11::arg("format") = "", pybind11::arg("chunk_size") = 65536,
+             pybind11::arg("num_threads") = 0)
+        .def("has_next", &FlexofferReader::has_next)
+        .def("next_batch", &FlexofferReader::next_batch, "Parse the next chunk of lines into a FlexofferBatch",
+             py::call_guard<py::gil_scoped_release>())
+        .def("next_flexoffers", &FlexofferReader::next_flexoffers, "Parse the next chunk of lines into Flexoffers",
+             py::call_guard<py::gil_scoped_release>())
+        .def("get_errors", &FlexofferReader::get_errors)
+        .def("clear_errors", &FlexofferReader::clear_errors)
+        .def("lines_read", &FlexofferReader::lines_read)
+        .def("__iter__", [](FlexofferReader& reader) -> FlexofferReader& { return reader; })
+        .def("__next__", [](FlexofferReader& reader) {
+            if (!reader.has_next()) throw py::stop_iteration();
+            py::gil_scoped_release release;
+            return reader.next_batch();
+        });
+
+    m.def("read_flexoffer_batch", &read_flexoffer_batch,
+        "Read a CSV/JSONL file of flexoffers into a FlexofferBatch; invalid rows raise unless skip_invalid is set.",
+        pybind11::arg("path"), pybind11::arg("format") = "", pybind11::arg("num_threads") = 0,
+        pybind11::arg("skip_invalid") = false,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("read_flexoffers", &read_flexoffers,
+        "Read a CSV/JSONL file of flexoffers; invalid rows raise unless skip_invalid is set.",
+        pybind11::arg("path"), pybind11::arg("format") = "", pybind11::arg("num_threads") = 0,
+        pybind11::arg("skip_invalid") = false,
+        py::call_guard<py::gil_scoped_release>());
+
+    m.def("set_instrumentation", &set_instrumentation,
+        "Turn the timers and counters on the hot paths on or off; with trace, also record every call for the trace export.",
+        pybind11::arg("enabled"), pybind11::arg("trace") = false);
+
+    m.def("reset_instrumentation", &reset_instrumentation, "Clear the recorded stats and trace events");
+
+    m.def("get_instrumentation_stats", &get_instrumentation_stats,
+        "Stats per function: {name: {\"calls\", \"total_ns\", counters...}}, summed over all threads");
+
+    m.def("get_instrumentation_trace", &get_instrumentation_trace,
+        "Chrome trace-event JSON of the calls recorded while tracing (chrome://tracing, Perfetto)");
+
+    m.def("write_instrumentation_trace", &write_instrumentation_trace,
+        "Write the Chrome trace-event JSON to a file", pybind11::arg("path"));
+}
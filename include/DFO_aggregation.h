@@ -8,15 +8,53 @@
 
 using namespace std;
 
+// Read-only view of a polygon's points as samples (x, y_min, y_max) in ascending x order.
+// Polygons store their points as (x, y_min), (x, y_max) pairs, so the view needs no copy and lookups never allocate.
+class PolygonView {
+private:
+    const Point* points;
+    size_t num_samples;
+
+    size_t lowerBound(double dependency_value) const;
+
+public:
+    explicit PolygonView(const vector<Point>& points);
+    PolygonView(const Point* points, size_t count);
+
+    bool valid() const { return num_samples > 0; } // False for polygons not laid out as min/max pairs
+    size_t size() const { return num_samples; }
+    double x(size_t k) const { return points[2 * k].x; }
+    double y_min(size_t k) const { return points[2 * k].y; }
+    double y_max(size_t k) const { return points[2 * k + 1].y; }
+
+    // Same result as findOrInterpolatePoints, returns false if dependency_value is outside the polygon
+    bool lookup(double dependency_value, double& min_energy, double& max_energy) const;
+};
+
 class DFO_Aggregation {
 public:
     static vector<DependencyPolygon> createStartPadding(int num_padding, int numsamples);
     static vector<DependencyPolygon> createEndPadding(const DFO& dfo, int num_padding, int numsamples);
     static vector<Point> findOrInterpolatePoints(const vector<Point>& points, double dependency_value);
+    static bool findOrInterpolate(const vector<Point>& points, double dependency_value, double& min_energy, double& max_energy);
     static double linearInterpolation(double x, double x0, double y0, double x1, double y1);
+    // Min/max usage of a polygon at a dependency value clamped to its x range; no points allow no usage
+    static void usageAt(const DependencyPolygon& polygon, double dependency_value, double& min_energy, double& max_energy);
+
+    // Timeline shared by aggregation and disaggregation: earliest start, start padding per DFO and aggregate length.
+    // resolution is the timestep length of the DFOs in seconds, in every function below.
+    static void alignDFOs(const vector<DFO>& dfos, time_t& start_time, vector<int>& pad_start, int& max_length, int resolution = 3600);
+
+    static DFO agg2to1(const DFO& dfo1, const DFO& dfo2, int numsamples, int resolution = 3600);
+    static DFO aggnto1(const vector<DFO>& dfos, int numsamples, int resolution = 3600);
+    static DFO aggnto1_kway(const vector<DFO>& dfos, int numsamples, int resolution = 3600);
+    static DFO aggnto1_parallel(const vector<DFO>& dfos, int numsamples, int num_threads = 0, int resolution = 3600);
 
-    static DFO agg2to1(const DFO& dfo1, const DFO& dfo2, int numsamples);
-    static DFO aggnto1(const vector<DFO>& dfos, int numsamples);
+    // Splits an energy trajectory of the aggregate of dfos (one usage per aggregated timestep) into one
+    // trajectory per member. The member trajectories add up to the aggregate one at every timestep, and every
+    // member step stays within usageAt of its polygon at the member's energy before it. Throws invalid_argument
+    // if no such split is found; the search is not exhaustive, so a few feasible trajectories are rejected too.
+    static vector<vector<double>> disaggregate(const vector<DFO>& dfos, const vector<double>& aggregate_usage, int resolution = 3600);
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,41 @@
+#ifndef DFO_BATCH_H
+#define DFO_BATCH_H
+
+#include <vector>
+#include <ctime>
+#include "DFO.h"
+
+using namespace std;
+
+// Dependency polygons of many DFOs in structure-of-arrays layout.
+// Polygons of all DFOs are numbered consecutively; DFO d owns polygons [dfo_offsets[d], dfo_offsets[d + 1]).
+// Samples are stored sample-major: sample i of polygon p lives at index i * num_polygons() + p.
+class DependencyPolygonBatch {
+public:
+    int numsamples;
+    vector<size_t> dfo_offsets;
+    vector<double> charging_power;   // Per DFO
+    vector<double> min_total_energy; // Per DFO
+    vector<double> max_total_energy; // Per DFO
+    vector<double> min_prev_energy;  // Per polygon
+    vector<double> max_prev_energy;  // Per polygon
+    vector<double> x;                // Per sample: dependency value
+    vector<double> y_min;            // Per sample: min energy usage
+    vector<double> y_max;            // Per sample: max energy usage
+
+    size_t num_dfos() const { return dfo_offsets.empty() ? 0 : dfo_offsets.size() - 1; }
+    size_t num_polygons() const { return min_prev_energy.size(); }
+
+    // Materializes DFO `index` with the same polygons DFO::generate_dependency_polygons would produce
+    DFO to_dfo(size_t index, int dfo_id, time_t earliest_start) const;
+    vector<DFO> to_dfos(const vector<int>& dfo_ids, const vector<time_t>& earliest_starts) const;
+};
+
+// Generates the dependency polygons of many DFOs at once from their min_prev/max_prev vectors.
+// charging_power holds one value per DFO, or a single value shared by all of them.
+DependencyPolygonBatch generate_dependency_polygons_batch(const vector<vector<double>>& min_prev,
+                                                          const vector<vector<double>>& max_prev,
+                                                          int numsamples,
+                                                          const vector<double>& charging_power);
+
+#endif
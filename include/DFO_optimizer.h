@@ -0,0 +1,30 @@
+#ifndef DFO_OPTIMIZER_H
+#define DFO_OPTIMIZER_H
+
+#include <ctime>
+#include <vector>
+#include "DFO.h"
+
+using namespace std;
+
+struct DFOSchedule {
+    vector<double> usage; // Energy used per timestep of the DFO
+    double cost;
+};
+
+// Cost-minimal energy trajectory through the dependency polygons of dfo, for prices per timestep starting at
+// price_start (the DFO's timestep t is charged prices[(earliest_start - price_start) / resolution + t]).
+//
+// Dynamic programming over num_states energy levels spanning the DFO's dependency range; the usage bounds of the
+// polygons (looked up like findOrInterpolatePoints) decide which levels follow which. The optimal path on the grid
+// is then followed with the real polygon bounds, so every usage is feasible and the cost is within a grid step's
+// worth of the optimum. Time is linear in the number of timesteps (times num_states).
+// Throws invalid_argument if the prices do not cover the DFO, runtime_error if no trajectory exists.
+DFOSchedule optimize_dfo(const DFO& dfo, const vector<double>& prices, time_t price_start,
+                         int resolution = 3600, int num_states = 201);
+
+// optimize_dfo for every DFO on num_threads threads
+vector<DFOSchedule> optimize_dfos(const vector<DFO>& dfos, const vector<double>& prices, time_t price_start,
+                                  int resolution = 3600, int num_states = 201, int num_threads = 0);
+
+#endif
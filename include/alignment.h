@@ -0,0 +1,34 @@
+#ifndef ALIGNMENT_H
+#define ALIGNMENT_H
+
+#include <vector>
+#include "flexoffer.h"
+
+using namespace std;
+
+// Aggregate of Flexoffers where member i starts shifts[i] slots after its own EST instead of at it
+// (start alignment is all shifts 0). Scheduling the aggregate moves every member by the same amount.
+// Slots are resolution seconds long; 0 uses the resolution set with set_time_resolution.
+struct AlignedAggregate {
+    Flexoffer aggregate;
+    vector<int> shifts;
+};
+
+// Balance alignment: members, largest energy first, are each placed at the shift within their time flexibility
+// where they add least to the squared aggregate profile (mid power per slot), which flattens the profile and lets
+// consumption and production cancel. Trades time flexibility of the aggregate for balance.
+AlignedAggregate balance_alignment_aggregate(const vector<Flexoffer>& flex_offers, int resolution = 0);
+
+// Best shift: starting from start alignment, moves one member at a time to its best shift until a pass changes
+// nothing (at most max_passes). Shifts are limited so the aggregate loses at most max_flexibility_loss slots of
+// time flexibility compared to start alignment; with 0 it keeps all of it.
+// Candidates are scored by the change they make within the member's own window of the running aggregate profile,
+// without rebuilding anything. Members whose profile is mostly runs of equal power are scored from prefix sums of
+// that window, O(duration + shifts * runs) per member; the others by a dot product, O(shifts * duration).
+AlignedAggregate best_shift_aggregate(const vector<Flexoffer>& flex_offers, int max_flexibility_loss = 0, int max_passes = 4,
+                                      int resolution = 0);
+
+// disaggregate_start_aligned for an aggregate built with the given shifts
+void disaggregate_aligned(const Flexoffer& aggregate, const vector<int>& shifts, vector<Flexoffer>& members, int resolution = 0);
+
+#endif
@@ -3,8 +3,33 @@
 
 #include <vector>
 #include "groups.h" 
+#include "flexoffer_batch.h"
 
 using namespace std;
+
+struct MBR {
+    int min_est_hour;
+    int max_est_hour;
+    int min_lst_hour;
+    int max_lst_hour;
+};
+
+// Outcome of clustering a list of units (initial groups), in final group order
+struct ClusterResult {
+    vector<vector<int>> clusters; // Unit indices of every resulting group, in merge order
+    vector<int> merge_index;      // -1 for a unit that was never merged, else the number of the merge that produced it
+};
+
+void createMBR(const Fo_Group&, MBR&);
+bool exceedsThreshold(const MBR&, int, int);
+ClusterResult clusterMBRs(const vector<MBR>& mbrs, const vector<int>& sizes, int est_threshold, int lst_threshold, int max_group_size);
 void clusterFo_Group(vector<Fo_Group>& groups, int est_threshold, int lst_threshold, int max_group_size);
+// Clusters every partition of groups that could ever be merged (see partitionMBRs) independently, in parallel.
+// Inside a partition only pairs within the thresholds are merge candidates, looked up through MBRGrid, and a
+// merge that breaks max_group_size only stops clustering of its own partition.
+void clusterFo_Group_partitioned(vector<Fo_Group>& groups, int est_threshold, int lst_threshold, int max_group_size, int num_threads = 0);
+
+// Same clustering as clusterFo_Group on one singleton group per offer, returning the offer indices of every group
+vector<vector<int>> clusterFlexofferBatch(const FlexofferBatch& batch, int est_threshold, int lst_threshold, int max_group_size);
 
-#endif 
\ No newline at end of file
+#endif 
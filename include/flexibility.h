@@ -0,0 +1,41 @@
+#ifndef FLEXIBILITY_H
+#define FLEXIBILITY_H
+
+#include <vector>
+#include "flexoffer.h"
+#include "flexoffer_batch.h"
+#include "groups.h"
+
+using namespace std;
+
+// Flexibility of a single Flexoffer, with slots of resolution seconds (0: the one set with set_time_resolution):
+// time flexibility in slots (LST - EST), energy flexibility in kWh (sum of max_power - min_power over the
+// profile), and absolute area in kWh: the area between the highest max_power and the lowest min_power any start
+// in [EST, LST] can put on each slot (no profile counts as 0 kW).
+double time_flexibility(const Flexoffer& fo, int resolution = 0);
+double energy_flexibility(const Flexoffer& fo, int resolution = 0);
+double absolute_area(const Flexoffer& fo, int resolution = 0);
+
+// Flexibility lost by aggregation, one entry per group. Every member is bound to the aggregate's time flexibility,
+// so the time loss is the sum over members of (member - aggregate); the energy and area losses are the members'
+// sum minus the aggregate's.
+class FlexibilityLoss {
+public:
+    vector<double> time_flex_loss;
+    vector<double> energy_flex_loss;
+    vector<double> area_loss;
+
+    explicit FlexibilityLoss(size_t num_groups = 0);
+    size_t size() const;
+};
+
+// Losses of groups[i] aggregated into aggregates[i]; without aggregates the start alignment aggregate of each group
+FlexibilityLoss flexibility_loss_groups(const vector<Fo_Group>& groups, const vector<Flexoffer>& aggregates = {},
+                                        int num_threads = 0, int resolution = 0);
+
+// Losses of the start alignment aggregates of clusters (offer indices, as returned by clusterFlexofferBatch),
+// read straight from the batch columns
+FlexibilityLoss flexibility_loss_batch(const FlexofferBatch& batch, const vector<vector<int>>& clusters, int num_threads = 0,
+                                       int resolution = 0);
+
+#endif
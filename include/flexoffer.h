@@ -6,6 +6,13 @@
 
 using namespace std;
 
+// Hours of a timestamp are taken in the system time zone, or at a fixed offset from UTC once one is set.
+// Set the offset before creating Flexoffers, as their hours are computed on construction.
+void set_timezone_offset(int offset_seconds);
+void use_local_timezone();
+struct tm to_calendar_time(time_t timestamp); // Reentrant, safe to call from several threads
+int hour_of(time_t timestamp);
+
 class TimeSlice {
     public:
         double min_power; // Minimum power in kW
@@ -25,6 +32,9 @@ class Flexoffer{
         double min_overall_alloc;
         double max_overall_alloc;
         time_t scheduled_start_time;
+        int est_hour; // Cached on construction, the hours are hot in clustering
+        int lst_hour;
+        int et_hour;
     public:
         //Constructor
         Flexoffer(int oi, time_t est, time_t lst, time_t et, vector<TimeSlice> &p, int d, double min = 0, double max = 0);
@@ -44,9 +54,16 @@ class Flexoffer{
         double get_min_overall_alloc() const;
         double get_max_overall_alloc() const;
 
+        // Reference access to the underlying storage, e.g. for zero-copy views
+        const vector<TimeSlice>& get_profile_ref() const;
+        vector<TimeSlice>& get_profile_ref();
+        const vector<double>& get_scheduled_allocation_ref() const;
+        vector<double>& get_scheduled_allocation_ref();
+
         // Setters
         void set_scheduled_allocation(std::vector<double>);
         void set_scheduled_start_time(time_t);
+        void assign_scheduled_allocation(const double* values, size_t size); // Reuses the storage when the size matches
 
         // Additional methods
         int get_est_hour() const;
@@ -0,0 +1,55 @@
+#ifndef FLEXOFFER_BATCH_H
+#define FLEXOFFER_BATCH_H
+
+#include <ctime>
+#include <vector>
+#include "flexoffer.h"
+
+using namespace std;
+
+// Many flexoffers stored column by column. The profile of offer i is the CSR range
+// [profile_offsets[i], profile_offsets[i + 1]) of min_power/max_power.
+class FlexofferBatch {
+public:
+    vector<int> offer_ids;
+    vector<time_t> earliest_start;
+    vector<time_t> latest_start;
+    vector<time_t> end_time;
+    vector<int> duration;
+    vector<double> min_overall_alloc;
+    vector<double> max_overall_alloc;
+    vector<size_t> profile_offsets;
+    vector<double> min_power;
+    vector<double> max_power;
+    vector<int> est_hour; // Cached like in Flexoffer
+    vector<int> lst_hour;
+
+    FlexofferBatch();
+    // Empty min/max overall allocations default to 0 for every offer
+    FlexofferBatch(vector<int> offer_ids, vector<time_t> earliest_start, vector<time_t> latest_start,
+                   vector<time_t> end_time, vector<int> duration, vector<size_t> profile_offsets,
+                   vector<double> min_power, vector<double> max_power,
+                   vector<double> min_overall_alloc = {}, vector<double> max_overall_alloc = {});
+
+    static FlexofferBatch from_flexoffers(const vector<Flexoffer>& flex_offers);
+
+    size_t size() const;
+    void add(const Flexoffer& fo);
+    void append(const FlexofferBatch& other);
+    void reserve(size_t num_offers, size_t num_slices);
+    Flexoffer to_flexoffer(size_t index) const;
+    vector<Flexoffer> to_flexoffers() const;
+
+    // Getters mirroring Flexoffer, by offer index
+    int get_offer_id(size_t index) const;
+    time_t get_est(size_t index) const;
+    time_t get_lst(size_t index) const;
+    time_t get_et(size_t index) const;
+    int get_duration(size_t index) const;
+    vector<TimeSlice> get_profile(size_t index) const;
+    int get_est_hour(size_t index) const;
+    int get_lst_hour(size_t index) const;
+    double get_total_energy(size_t index) const;
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef FLEXOFFER_READER_H
+#define FLEXOFFER_READER_H
+
+#include <cstddef>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "flexoffer.h"
+#include "flexoffer_batch.h"
+
+using namespace std;
+
+// Rows have the fields offer_id, earliest_start, latest_start, end_time (unix seconds), min_power and
+// max_power (one value per time slice), and optionally duration (must equal the profile length),
+// min_overall_alloc and max_overall_alloc (default 0).
+//  - CSV: a header row names the columns in any order; power lists are separated by ';' or spaces,
+//    or by commas inside a quoted field.
+//  - JSONL: one object per line; power lists are arrays of numbers, unknown keys are ignored.
+
+struct FlexofferParseError {
+    size_t line; // 1-based line in the file
+    string message;
+};
+
+// Reads a CSV/JSONL file of flexoffers in chunks of at most chunk_size lines, so memory stays bounded
+// by the chunk and not the file. Each chunk is parsed on up to num_threads threads. Invalid rows are
+// skipped and recorded in get_errors().
+class FlexofferReader {
+public:
+    // format is "csv", "jsonl" or "" to pick it from the file extension
+    FlexofferReader(const string& path, const string& format = "", size_t chunk_size = 65536, int num_threads = 0);
+
+    bool has_next();
+    FlexofferBatch next_batch();
+    vector<Flexoffer> next_flexoffers();
+    const vector<FlexofferParseError>& get_errors() const;
+    void clear_errors();
+    size_t lines_read() const;
+
+private:
+    ifstream file;
+    bool jsonl;
+    size_t chunk_size;
+    int num_threads;
+    size_t line_number;
+    vector<int> csv_columns; // Field parsed from each CSV column, -1 for ignored columns
+    vector<string> lines; // Reused between chunks
+    vector<size_t> line_numbers;
+    vector<FlexofferParseError> errors;
+
+    void readHeader();
+    size_t readChunk();
+};
+
+// Reads a whole file; invalid rows raise an error unless skip_invalid is set
+FlexofferBatch read_flexoffer_batch(const string& path, const string& format = "", int num_threads = 0, bool skip_invalid = false);
+vector<Flexoffer> read_flexoffers(const string& path, const string& format = "", int num_threads = 0, bool skip_invalid = false);
+
+#endif
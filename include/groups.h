@@ -15,6 +15,7 @@ public:
 
     void addFlexOffer(const Flexoffer &fo);
     const vector<Flexoffer>& getFlexOffers() const;
+    vector<Flexoffer>& getFlexOffers();
     int getGroupId() const;
 };
 #endif // GROUP_H
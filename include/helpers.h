@@ -2,8 +2,9 @@
 #define HELPERS_H
 
 #include "flexoffer.h"
+#include "flexoffer_batch.h"
+#include "groups.h"
 
-#include <pybind11/pybind11.h>
 #include <vector>
 #include <tuple>
 #include <algorithm>
@@ -11,12 +12,26 @@
 #include <stdexcept>
 #include <limits>
 
-namespace py = pybind11;
 using namespace std;
 
 void set_time_resolution(int);
+int get_time_resolution();
+// The slot length in seconds to use for a call: resolution if positive, otherwise the one set with
+// set_time_resolution. Functions taking a resolution default it to 0, so the global is only read for them,
+// and callers working at several resolutions at once can pass it per call instead of changing the global.
+int resolve_time_resolution(int resolution);
 tuple<int, int> compute_aggregated_window(const vector<Flexoffer>&);
-vector<int> compute_offsets_and_length(const vector<Flexoffer>&, int, int&);
-Flexoffer start_alignment_aggregate(const vector<Flexoffer>&);
+vector<int> compute_offsets_and_length(const vector<Flexoffer>&, int, int&, int resolution = 0);
+Flexoffer start_alignment_aggregate(const vector<Flexoffer>&, int resolution = 0);
+// Start alignment aggregate of every group, computed in parallel on num_threads threads
+vector<Flexoffer> start_alignment_aggregate_groups(const vector<Fo_Group>&, int num_threads = 0, int resolution = 0);
+// Pushes the schedule of a start alignment aggregate down to its members: every member starts shifted like the
+// aggregate, and each slot's allocation is split in proportion to the members' [min_power, max_power] headroom
+void disaggregate_start_aligned(const Flexoffer& aggregate, vector<Flexoffer>& members, int resolution = 0);
+// Disaggregates aggregates[i] into a copy of groups[i], for all groups in parallel on num_threads threads
+vector<Fo_Group> disaggregate_groups(const vector<Flexoffer>& aggregates, const vector<Fo_Group>& groups, int num_threads = 0,
+                                     int resolution = 0);
+// Start alignment aggregate of the offers at `indices` (all offers if empty), read straight from the batch columns
+Flexoffer start_alignment_aggregate_batch(const FlexofferBatch&, const vector<int>& indices = {}, int resolution = 0);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,52 @@
+#ifndef INCREMENTAL_AGGREGATE_H
+#define INCREMENTAL_AGGREGATE_H
+
+#include <ctime>
+#include <deque>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "flexoffer.h"
+
+using namespace std;
+
+// Start alignment aggregate that is kept up to date while members join and leave.
+// Adding or removing a member costs O(duration + log n); aggregate() produces the same Flexoffer as
+// start_alignment_aggregate over the current members, as long as all ESTs share the same alignment
+// to the time resolution (offsets are counted in whole slots from a fixed anchor).
+class IncrementalAggregate {
+private:
+    struct Member {
+        time_t earliest_start;
+        int flexibility;
+        long long first_slot;
+        long long end_slot;
+        vector<TimeSlice> profile;
+    };
+
+    int resolution;
+    bool has_anchor;
+    time_t anchor;                        // Slot 0 starts here; set by the first member ever added
+    unordered_map<int, Member> members;   // By offer id
+    multiset<time_t> earliest_starts;
+    multiset<int> flexibilities;
+    multiset<long long> end_slots;
+    long long base_slot;                  // Slot of profile_sum[0]
+    deque<TimeSlice> profile_sum;
+
+    long long slotOf(time_t timestamp) const;
+    void trim();
+
+public:
+    // resolution in seconds, <= 0 uses the resolution set with set_time_resolution
+    explicit IncrementalAggregate(int resolution = 0);
+
+    void add(const Flexoffer& fo);
+    bool remove(int offer_id);
+    bool contains(int offer_id) const;
+    size_t size() const;
+
+    Flexoffer aggregate() const;
+};
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include <atomic>
+#include <map>
+#include <string>
+
+using namespace std;
+
+// Optional timers and counters on the hot paths. Off by default: a disabled scope costs one relaxed atomic load.
+// Building with FLEXOFFER_NO_INSTRUMENTATION defined removes the macros below altogether.
+//
+//   INSTRUMENT_SCOPE("agg2to1");                    // Counts a call and its duration, until the end of the scope
+//   INSTRUMENT_COUNT("agg2to1", "points", n);       // Adds n to a counter; n is only evaluated while enabled
+
+extern atomic<bool> instrumentation_flag;
+
+inline bool instrumentation_active() {return instrumentation_flag.load(memory_order_relaxed);}
+
+// trace also records every scope as a trace event, for write_instrumentation_trace
+void set_instrumentation(bool enabled, bool trace = false);
+void reset_instrumentation();
+
+// Scope name -> {"calls", "total_ns", counters...}, summed over all threads
+map<string, map<string, long long>> get_instrumentation_stats();
+
+// Chrome trace-event JSON (chrome://tracing, Perfetto) of the scopes recorded while tracing was on
+string get_instrumentation_trace();
+void write_instrumentation_trace(const string& path);
+
+long long instrumentation_now_ns();
+void instrumentation_record(const char* name, long long start_ns, long long end_ns);
+void instrumentation_count(const char* name, const char* counter, long long amount);
+
+class InstrumentationScope {
+private:
+    const char* name;
+    long long start_ns;
+
+public:
+    explicit InstrumentationScope(const char* name)
+        : name(instrumentation_active() ? name : nullptr), start_ns(this->name ? instrumentation_now_ns() : 0) {}
+    ~InstrumentationScope() {
+        if (name) instrumentation_record(name, start_ns, instrumentation_now_ns());
+    }
+
+    InstrumentationScope(const InstrumentationScope&) = delete;
+    InstrumentationScope& operator=(const InstrumentationScope&) = delete;
+};
+
+#ifdef FLEXOFFER_NO_INSTRUMENTATION
+#define INSTRUMENT_SCOPE(name)
+#define INSTRUMENT_COUNT(name, counter, amount)
+#else
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+#define INSTRUMENT_SCOPE(name) InstrumentationScope INSTRUMENT_CONCAT(instrumentation_scope_, __LINE__)(name)
+#define INSTRUMENT_COUNT(name, counter, amount) \
+    do { if (instrumentation_active()) instrumentation_count(name, counter, static_cast<long long>(amount)); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef ONLINE_CLUSTERER_H
+#define ONLINE_CLUSTERER_H
+
+#include <ctime>
+#include <map>
+#include <set>
+#include <unordered_map>
+#include <vector>
+#include "clusters.h"
+#include "flexoffer.h"
+#include "groups.h"
+#include "spatial_index.h"
+
+using namespace std;
+
+// Clustering of a stream of Flexoffers under the thresholds of clusterFo_Group, kept up to date one offer at a time.
+// A new offer joins the group with the nearest MBR centroid that can take it without breaking est_threshold,
+// lst_threshold or max_group_size, or starts a new group. Groups that still have room are kept in an MBRGrid, so
+// an insert only looks at neighbouring cells. Groups are not merged with each other afterwards, so the result can
+// differ from clustering all live offers at once. Offers are placed by their absolute EST/LST hour (hours since the
+// Unix epoch) rather than the hour of day, as the stream spans days: the same hour on another day is 24 hours away.
+//
+// Every change is recorded: take_changed_groups() returns the ids of the groups created, grown, shrunk or emptied
+// since the previous call. Emptied groups are gone by then (has_group is false).
+class OnlineClusterer {
+private:
+    struct Group {
+        MBR mbr;
+        vector<Flexoffer> offers;
+        multiset<int> est_hours; // Absolute hours of the members
+        multiset<int> lst_hours;
+    };
+
+    struct Placement {
+        int group_id;
+        size_t position; // Index in the group's offers
+        multimap<time_t, int>::iterator expiry;
+    };
+
+    int est_threshold;
+    int lst_threshold;
+    int max_group_size;
+    int next_group_id;
+    MBRGrid open_groups; // Groups with room for another offer
+    unordered_map<int, Group> groups;
+    unordered_map<int, Placement> placements; // By offer id
+    multimap<time_t, int> expiries;           // Latest start time -> offer id
+    set<int> changed;
+
+    int nearestOpenGroup(int est_hour, int lst_hour) const;
+    void refreshMBR(int group_id, Group& group);
+
+public:
+    OnlineClusterer(int est_threshold, int lst_threshold, int max_group_size);
+
+    // Returns the id of the group the offer joined; throws if its offer id is already live
+    int insert(const Flexoffer& fo);
+    vector<int> insert_many(const vector<Flexoffer>& flex_offers);
+    // Returns false if the offer is not live
+    bool remove(int offer_id);
+    // Removes every offer whose latest start time is before now and returns their ids
+    vector<int> remove_expired(time_t now);
+
+    vector<int> take_changed_groups();
+
+    bool contains(int offer_id) const;
+    bool has_group(int group_id) const;
+    int group_of(int offer_id) const; // -1 if the offer is not live
+    Fo_Group get_group(int group_id) const;
+    vector<Fo_Group> get_groups() const; // Ordered by group id
+    size_t size() const;                 // Live offers
+    size_t num_groups() const;
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <cstddef>
+#include <functional>
+
+using namespace std;
+
+// Returns the number of worker threads to use; values <= 0 mean "all hardware threads".
+int resolve_num_threads(int num_threads);
+
+// Runs body(i) for every i in [0, count) on up to num_threads threads.
+// The first exception thrown by a worker is rethrown on the calling thread.
+void parallel_for(size_t count, int num_threads, const function<void(size_t)>& body);
+
+#endif
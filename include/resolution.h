@@ -0,0 +1,29 @@
+#ifndef RESOLUTION_H
+#define RESOLUTION_H
+
+#include "DFO.h"
+#include "flexoffer.h"
+
+#include <vector>
+
+using namespace std;
+
+// Coarsening from resolution to coarse_resolution seconds per timestep, e.g. 15-minute data to 30 or 60 minutes.
+// coarse_resolution must be a multiple of resolution; every coarse timestep covers that many fine timesteps
+// (the last one possibly fewer), counted from the offer's earliest start.
+
+// Each coarse polygon keeps the dependency range of its first fine timestep and, for every sample, the least and
+// most energy reachable over the fine timesteps it covers. Coarsening at factor 1 returns the same polygons.
+DFO coarsen_dfo(const DFO& dfo, int resolution, int coarse_resolution);
+vector<DFO> coarsen_dfos(const vector<DFO>& dfos, int resolution, int coarse_resolution, int num_threads = 0);
+
+// Coarse slices carry the average power of the fine slices they cover, so the energy bounds stay the same.
+// Coarse start times are the fine ones that lie on the coarse grid from the earliest start.
+Flexoffer coarsen_flexoffer(const Flexoffer& fo, int resolution, int coarse_resolution);
+vector<Flexoffer> coarsen_flexoffers(const vector<Flexoffer>& fos, int resolution, int coarse_resolution, int num_threads = 0);
+
+// Pushes the schedule of coarsen_flexoffer(fine, ...) down to fine: same start time, and each coarse slot's
+// power is spread over its fine slots in proportion to their [min_power, max_power] headroom
+void refine_flexoffer_schedule(const Flexoffer& coarse, Flexoffer& fine, int resolution, int coarse_resolution);
+
+#endif
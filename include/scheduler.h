@@ -0,0 +1,29 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <ctime>
+#include <vector>
+#include "flexoffer.h"
+
+using namespace std;
+
+// Schedules Flexoffers against a price per slot (e.g. hourly spot prices per kWh), prices[k] covering
+// [price_start + k * resolution, price_start + (k + 1) * resolution). resolution <= 0 uses the resolution
+// set with set_time_resolution.
+//
+// The start is the one in [EST, LST], stepped by the resolution, whose slots have the lowest summed price
+// (a sliding window over prefix sums, the earliest one on ties). Its allocation starts at every slice's
+// min_power, tops up the cheapest slots until min_overall_alloc is reached and adds energy to slots with a
+// negative price up to max_overall_alloc, always within [min_power, max_power]. Overall allocations are energy,
+// the allocation per slot is power, as in the profile.
+//
+// Results go through set_scheduled_start_time / set_scheduled_allocation; the return value is the cost.
+// Throws invalid_argument if no start of the offer has all its slots within the prices, or if no allocation
+// within the profile meets its overall allocation bounds (both 0, the default, means no overall bounds).
+double schedule_flexoffer(Flexoffer& fo, const vector<double>& prices, time_t price_start, int resolution = 0);
+
+// schedule_flexoffer for every offer on num_threads threads, returning the cost per offer
+vector<double> schedule_flexoffers(vector<Flexoffer>& flex_offers, const vector<double>& prices, time_t price_start,
+                                   int resolution = 0, int num_threads = 0);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef SERIALIZATION_H
+#define SERIALIZATION_H
+
+#include <string>
+#include <vector>
+#include "DFO.h"
+#include "flexoffer.h"
+#include "flexoffer_batch.h"
+#include "groups.h"
+
+using namespace std;
+
+// Versioned little-endian binary snapshots. A snapshot is a 16 byte header (magic "FLXO", u16 version,
+// u16 kind, u64 item count) followed by flat column sections, each a u64 byte length plus the raw array,
+// padded to 8 bytes. Columns are read with one bulk copy each, and the alignment lets NumPy memory-map them.
+// Single objects (used for pickling) are snapshots of one item.
+
+string serialize_flexoffers(const vector<Flexoffer>& flex_offers);
+vector<Flexoffer> deserialize_flexoffers(const string& data);
+string serialize_flexoffer_batch(const FlexofferBatch& batch);
+FlexofferBatch deserialize_flexoffer_batch(const string& data); // Also reads snapshots of Flexoffers
+string serialize_dfos(const vector<DFO>& dfos);
+vector<DFO> deserialize_dfos(const string& data);
+string serialize_groups(const vector<Fo_Group>& groups);
+vector<Fo_Group> deserialize_groups(const string& data);
+
+// Collections on disk; loading memory-maps the file where the platform allows it
+void save_flexoffers(const string& path, const vector<Flexoffer>& flex_offers);
+vector<Flexoffer> load_flexoffers(const string& path);
+FlexofferBatch load_flexoffer_batch(const string& path);
+void save_dfos(const string& path, const vector<DFO>& dfos);
+vector<DFO> load_dfos(const string& path);
+void save_groups(const string& path, const vector<Fo_Group>& groups);
+vector<Fo_Group> load_groups(const string& path);
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SPATIAL_INDEX_H
+#define SPATIAL_INDEX_H
+
+#include <unordered_map>
+#include <vector>
+#include "clusters.h"
+
+using namespace std;
+
+// Uniform grid over (est_hour, lst_hour) that buckets MBRs by their lower corner.
+// Cells are one threshold wide, so every MBR that can be merged with a query MBR
+// lies in one of a handful of neighbouring cells.
+class MBRGrid {
+private:
+    int est_threshold;
+    int lst_threshold;
+    unordered_map<long long, vector<int>> cells;
+    unordered_map<int, MBR> entries;
+    unordered_map<int, size_t> positions; // Index of each id inside its cell
+
+    long long cellKey(const MBR& mbr) const;
+    long long cellKey(int est_cell, int lst_cell) const;
+
+public:
+    MBRGrid(int est_threshold, int lst_threshold);
+
+    void insert(int id, const MBR& mbr);
+    void remove(int id);
+    void update(int id, const MBR& mbr);
+    bool contains(int id) const;
+    size_t size() const;
+
+    // Ids of all MBRs whose union with mbr stays within the thresholds
+    vector<int> mergeCandidates(const MBR& mbr) const;
+};
+
+// Splits units into partitions that can never be merged with each other under the thresholds.
+// Partitions are ordered by their first unit, units inside a partition keep their order.
+vector<vector<int>> partitionMBRs(const vector<MBR>& mbrs, int est_threshold, int lst_threshold);
+
+#endif
@@ -4,7 +4,13 @@ import pybind11
 ext_modules = [
     Extension(
         "flexoffer_logic",
-        ["bindings.cpp", "src/clusters.cpp", "src/flexoffer.cpp", "src/groups.cpp", "src/helpers.cpp", "src/DFO.cpp"],
+        ["bindings.cpp", "src/clusters.cpp", "src/flexoffer.cpp", "src/groups.cpp", "src/helpers.cpp", "src/DFO.cpp",
+         "src/DFO_aggregation.cpp", "src/DFO_batch.cpp", "src/parallel.cpp",
+         "src/spatial_index.cpp", "src/flexoffer_batch.cpp",
+         "src/incremental_aggregate.cpp", "src/serialization.cpp",
+         "src/flexoffer_reader.cpp", "src/instrumentation.cpp", "src/resolution.cpp",
+         "src/scheduler.cpp", "src/DFO_optimizer.cpp", "src/alignment.cpp",
+         "src/flexibility.cpp", "src/online_clusterer.cpp"],
         include_dirs=[pybind11.get_include(), "../include"],  
         language="c++",
     ),
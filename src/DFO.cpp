@@ -1,10 +1,12 @@
 #include "../include/DFO.h"
+#include "../include/instrumentation.h"
 #include <iostream>
 #include <iomanip>
 #include <sstream>
 #include <ctime>
 #include <cmath>
 #include <algorithm>
+#include <array>
 
 using namespace std;
 
@@ -22,6 +24,27 @@ ostream& operator<<(ostream& os, const Point& point) {
     return os;
 }
 
+static bool point_less(const Point& a, const Point& b) {
+    return a.x < b.x || (a.x == b.x && a.y < b.y);
+}
+
+/** 🔹 Kernel: the samples of generate_polygon for a sample count known at compile time. The bounds are
+ *  computed into fixed size arrays first, a loop the compiler fully unrolls and vectorizes. */
+template <int N>
+static void generate_samples(double min_prev, double step, double charging_power,
+                             double next_min_prev, double next_max_prev, vector<Point>& points) {
+    array<double, N> x, y_min, y_max;
+    for (int i = 0; i < N; ++i) {
+        x[i] = min_prev + i * step;
+        y_min[i] = min(max(next_min_prev - x[i], 0.0), charging_power); // Limit to charging power
+        y_max[i] = min(max(next_max_prev - x[i], 0.0), charging_power);
+    }
+    for (int i = 0; i < N; ++i) {
+        points.emplace_back(x[i], y_min[i]);
+        points.emplace_back(x[i], y_max[i]);
+    }
+}
+
 DependencyPolygon::DependencyPolygon(double min_prev, double max_prev, int numsamples)
     : min_prev_energy(min_prev), max_prev_energy(max_prev), numsamples(numsamples) {}
 
@@ -38,21 +61,28 @@ void DependencyPolygon::generate_polygon(double charging_power, double next_min_
     }
 
     double step = (max_prev_energy - min_prev_energy) / (numsamples - 1);
-    for (int i = 0; i < numsamples; ++i) {
-        double current_prev_energy = min_prev_energy + i * step;
-
-        // Calculate the min and max energy needed for the next time slice
-        double min_current_energy = max(next_min_prev - current_prev_energy, 0.0);
-        min_current_energy = min(min_current_energy, charging_power); // Limit to charging power
-        double max_current_energy = max(next_max_prev - current_prev_energy, 0.0);
-        max_current_energy = min(max_current_energy, charging_power); // Limit to charging power
-
-        // Add the points to the polygon
-        add_point(current_prev_energy, min_current_energy);
-        add_point(current_prev_energy, max_current_energy);
+    points.reserve(points.size() + 2 * numsamples);
+    switch (numsamples) {
+        case 5: generate_samples<5>(min_prev_energy, step, charging_power, next_min_prev, next_max_prev, points); break;
+        case 10: generate_samples<10>(min_prev_energy, step, charging_power, next_min_prev, next_max_prev, points); break;
+        default:
+            for (int i = 0; i < numsamples; ++i) {
+                double current_prev_energy = min_prev_energy + i * step;
+
+                // Calculate the min and max energy needed for the next time slice
+                double min_current_energy = max(next_min_prev - current_prev_energy, 0.0);
+                min_current_energy = min(min_current_energy, charging_power); // Limit to charging power
+                double max_current_energy = max(next_max_prev - current_prev_energy, 0.0);
+                max_current_energy = min(max_current_energy, charging_power); // Limit to charging power
+
+                // Add the points to the polygon
+                add_point(current_prev_energy, min_current_energy);
+                add_point(current_prev_energy, max_current_energy);
+            }
     }
 
-    sort_points();
+    // Samples come out in ascending x with min before max, so only hand-added points need sorting
+    if (!is_sorted(points.begin(), points.end(), point_less)) sort_points();
 }
 
 void DependencyPolygon::add_point(double x, double y) {
@@ -60,9 +90,7 @@ void DependencyPolygon::add_point(double x, double y) {
 }
 
 void DependencyPolygon::sort_points() {
-    sort(points.begin(), points.end(), [](const Point& a, const Point& b) {
-        return a.x < b.x || (a.x == b.x && a.y < b.y);
-    });
+    sort(points.begin(), points.end(), point_less);
 }
 
 void DependencyPolygon::print_polygon(int index) const {
@@ -95,6 +123,7 @@ DFO::DFO(int dfo_id, const vector<double>& min_prev, const vector<double>& max_p
         throw runtime_error("min_prev and max_prev cannot be empty.");
     }
 
+    polygons.reserve(min_prev.size());
     for (size_t i = 0; i < min_prev.size(); ++i) {
         polygons.emplace_back(min_prev[i], max_prev[i], numsamples);
     }
@@ -104,12 +133,18 @@ DFO::DFO(int dfo_id, const vector<double>& min_prev, const vector<double>& max_p
 }
 
 void DFO::generate_dependency_polygons() {
+    INSTRUMENT_SCOPE("generate_dependency_polygons");
     for (size_t i = 0; i < polygons.size(); ++i) {
         if (i < polygons.size() - 1) { // Generate allowed energy usage based on min/max dependency from the next timestep
             polygons[i].generate_polygon(charging_power, polygons[i + 1].min_prev_energy, polygons[i + 1].max_prev_energy);
         }
     }
     polygons.pop_back(); // Remove the last polygon, as it was only there such that the loop could generate the second-to-last polygon
+    if (instrumentation_active()) {
+        size_t points = 0;
+        for (const DependencyPolygon& polygon : polygons) points += polygon.points.size();
+        instrumentation_count("generate_dependency_polygons", "points", points);
+    }
 }
 
 void DFO::print_dfo() const {
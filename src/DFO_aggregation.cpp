@@ -1,6 +1,11 @@
 #include "../include/DFO_aggregation.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+#include <array>
+#include <cmath>
 #include <iostream>
 #include <limits>
+#include <memory>
 #include <stdexcept>
 
 using namespace std;
@@ -57,6 +62,7 @@ double DFO_Aggregation::linearInterpolation(double x, double x0, double y0, doub
 
 /** 🔹 Helper function: Finds or interpolates points for a given dependency value. */
 vector<Point> DFO_Aggregation::findOrInterpolatePoints(const vector<Point>& points, double dependency_value) {
+    INSTRUMENT_SCOPE("findOrInterpolatePoints");
     vector<Point> matching_points;
     
     for (const Point& p : points) {
@@ -84,104 +90,826 @@ vector<Point> DFO_Aggregation::findOrInterpolatePoints(const vector<Point>& poin
     return matching_points;
 }
 
-/** 🔹 Function: Aggregates two DFOs into one, handling misaligned start times by padding with temporary polygons. */
-DFO DFO_Aggregation::agg2to1(const DFO& dfo1, const DFO& dfo2, int numsamples) {
+PolygonView::PolygonView(const vector<Point>& points) : PolygonView(points.data(), points.size()) {}
 
-    // Determine the earliest start time
-    time_t start_time = min(dfo1.earliest_start, dfo2.earliest_start);
+PolygonView::PolygonView(const Point* points, size_t count)
+    : points(points), num_samples(count % 2 == 0 ? count / 2 : 0) {}
 
-    // Compute how many padding polygons are needed at the start for each DFO
-    int pad_start_1 = static_cast<int>((dfo1.earliest_start - start_time) / 3600);
-    int pad_start_2 = static_cast<int>((dfo2.earliest_start - start_time) / 3600);
+/** 🔹 Helper function: Index of the first sample with x >= dependency_value, using the uniform step as first guess. */
+size_t PolygonView::lowerBound(double dependency_value) const {
+    double first = x(0);
+    double last = x(num_samples - 1);
 
-    // Compute how many padding polygons are needed at the end for each DFO
-    int max_length = max(dfo1.polygons.size() + pad_start_1, dfo2.polygons.size() + pad_start_2);
-    int pad_end_1 = max_length - (dfo1.polygons.size() + pad_start_1);
-    int pad_end_2 = max_length - (dfo2.polygons.size() + pad_start_2);
+    if (num_samples > 1 && last > first) {
+        double guess = (dependency_value - first) / (last - first) * (num_samples - 1);
+        if (guess >= 0.0 && guess < static_cast<double>(num_samples)) {
+            size_t k = static_cast<size_t>(guess);
+            // Accept the guess only if it really is the lower bound, otherwise fall back to binary search
+            if (k + 1 < num_samples && x(k) < dependency_value && dependency_value <= x(k + 1)) return k + 1;
+            if (x(k) >= dependency_value && (k == 0 || x(k - 1) < dependency_value)) return k;
+        }
+    }
+
+    size_t lo = 0, hi = num_samples;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (x(mid) < dependency_value) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+bool PolygonView::lookup(double dependency_value, double& min_energy, double& max_energy) const {
+    if (num_samples == 0) return false;
+
+    size_t k = lowerBound(dependency_value);
+    if (k < num_samples && x(k) == dependency_value) { // Existing sample with that dependency value
+        min_energy = y_min(k);
+        max_energy = y_max(k);
+        return true;
+    }
+    if (k == 0 || k == num_samples) return false;
+
+    // Otherwise perform linear interpolation on the samples before and after dependency_value
+    min_energy = DFO_Aggregation::linearInterpolation(dependency_value, x(k - 1), y_min(k - 1), x(k), y_min(k));
+    max_energy = DFO_Aggregation::linearInterpolation(dependency_value, x(k - 1), y_max(k - 1), x(k), y_max(k));
+    return true;
+}
 
-    // Create padded versions of the polygons
-    vector<DependencyPolygon> padded_polygons_1 = createStartPadding(pad_start_1, numsamples);
-    padded_polygons_1.insert(padded_polygons_1.end(), dfo1.polygons.begin(), dfo1.polygons.end());
-    vector<DependencyPolygon> end_padding_1 = createEndPadding(dfo1, pad_end_1, numsamples);
-    padded_polygons_1.insert(padded_polygons_1.end(), end_padding_1.begin(), end_padding_1.end());
+/** 🔹 Helper function: Allocation-free findOrInterpolatePoints, writing the min/max energy usage. */
+bool DFO_Aggregation::findOrInterpolate(const vector<Point>& points, double dependency_value, double& min_energy, double& max_energy) {
+    PolygonView view(points);
+    if (view.valid()) return view.lookup(dependency_value, min_energy, max_energy);
+
+    // Points not laid out as min/max pairs (e.g. added by hand), use the general scan
+    vector<Point> matching_points = findOrInterpolatePoints(points, dependency_value);
+    if (matching_points.size() < 2) return false;
+    min_energy = matching_points[0].y;
+    max_energy = matching_points[1].y;
+    return true;
+}
+
+/** 🔹 Helper function: findOrInterpolate at a dependency value clamped to the polygon, so values rounded just
+ *  past its last x still hit it. Polygons without points allow no usage. */
+void DFO_Aggregation::usageAt(const DependencyPolygon& polygon, double dependency_value, double& min_energy, double& max_energy) {
+    min_energy = max_energy = 0.0;
+    if (polygon.points.empty()) return;
+    double x = min(max(dependency_value, polygon.points.front().x), polygon.points.back().x);
+    if (!findOrInterpolate(polygon.points, x, min_energy, max_energy)) {
+        min_energy = max_energy = 0.0;
+    }
+}
+
+/** 🔹 Helper function: Rejects resolutions that cannot be a timestep length. */
+static void checkResolution(int resolution) {
+    if (resolution <= 0) throw invalid_argument("resolution must be a positive number of seconds per timestep.");
+}
 
-    vector<DependencyPolygon> padded_polygons_2 = createStartPadding(pad_start_2, numsamples);
-    padded_polygons_2.insert(padded_polygons_2.end(), dfo2.polygons.begin(), dfo2.polygons.end());
-    vector<DependencyPolygon> end_padding_2 = createEndPadding(dfo2, pad_end_2, numsamples);
-    padded_polygons_2.insert(padded_polygons_2.end(), end_padding_2.begin(), end_padding_2.end());
+/** 🔹 Helper function: Aligns DFOs on a common timeline of resolution-second timesteps starting at the earliest start time. */
+void DFO_Aggregation::alignDFOs(const vector<DFO>& dfos, time_t& start_time, vector<int>& pad_start, int& max_length, int resolution) {
+    checkResolution(resolution);
+    start_time = dfos.empty() ? 0 : dfos[0].earliest_start;
+    for (const DFO& dfo : dfos) start_time = min(start_time, dfo.earliest_start);
+
+    pad_start.assign(dfos.size(), 0);
+    max_length = 0;
+    for (size_t m = 0; m < dfos.size(); m++) {
+        pad_start[m] = static_cast<int>((dfos[m].earliest_start - start_time) / resolution);
+        max_length = max(max_length, pad_start[m] + static_cast<int>(dfos[m].polygons.size()));
+    }
+}
+
+/** 🔹 Helper: polygons of aggregates in one contiguous arena. Polygon p owns points [offsets[p], offsets[p + 1]),
+ *  so building an aggregate costs a handful of allocations instead of one per timestep. */
+struct PolygonArena {
+    vector<Point> points;
+    vector<size_t> offsets{0};
+    vector<double> min_prev_energy;
+    vector<double> max_prev_energy;
+    time_t earliest_start = 0;
+
+    size_t size() const { return min_prev_energy.size(); }
+
+    void clear() {
+        points.clear();
+        offsets.assign(1, 0);
+        min_prev_energy.clear();
+        max_prev_energy.clear();
+    }
 
-    // Aggregate the aligned polygons
-    vector<DependencyPolygon> aggregated_polygons;
+    void reserve(size_t num_polygons, size_t num_points) {
+        points.reserve(num_points);
+        offsets.reserve(num_polygons + 1);
+        min_prev_energy.reserve(num_polygons);
+        max_prev_energy.reserve(num_polygons);
+    }
+
+    void addPolygon(double min_prev, double max_prev) {
+        min_prev_energy.push_back(min_prev);
+        max_prev_energy.push_back(max_prev);
+    }
+
+    void endPolygon() { offsets.push_back(points.size()); }
+
+    // The only place where an aggregate gets its per timestep vectors
+    DFO toDFO(int numsamples) const {
+        INSTRUMENT_COUNT("materialize_dfo", "allocations", size() + 1);
+        INSTRUMENT_COUNT("materialize_dfo", "points", points.size());
+        DFO aggregated_DFO = DFO(-1, {0}, {0}, numsamples, 0.0, -1, -1, earliest_start);
+        aggregated_DFO.polygons.clear();
+        aggregated_DFO.polygons.reserve(size());
+        for (size_t p = 0; p < size(); p++) {
+            DependencyPolygon polygon(min_prev_energy[p], max_prev_energy[p], numsamples);
+            polygon.points.assign(points.begin() + offsets[p], points.begin() + offsets[p + 1]);
+            aggregated_DFO.polygons.push_back(move(polygon));
+        }
+        return aggregated_DFO;
+    }
+};
+
+/** 🔹 Helper: read access to one polygon, wherever its points are stored. */
+struct PolygonSpan {
+    const Point* points;
+    size_t count;
+    double min_prev_energy;
+    double max_prev_energy;
+};
+
+/** 🔹 Helper: the polygons of one aggregation member, either a DFO or an aggregate kept in a PolygonArena. */
+struct MemberPolygons {
+    const DFO* dfo;
+    const PolygonArena* arena;
+
+    explicit MemberPolygons(const DFO& dfo) : dfo(&dfo), arena(nullptr) {}
+    explicit MemberPolygons(const PolygonArena& arena) : dfo(nullptr), arena(&arena) {}
+
+    time_t earliest_start() const { return dfo ? dfo->earliest_start : arena->earliest_start; }
+    size_t size() const { return dfo ? dfo->polygons.size() : arena->size(); }
+
+    PolygonSpan at(size_t i) const {
+        if (dfo) {
+            const DependencyPolygon& polygon = dfo->polygons[i];
+            return {polygon.points.data(), polygon.points.size(), polygon.min_prev_energy, polygon.max_prev_energy};
+        }
+        return {arena->points.data() + arena->offsets[i], arena->offsets[i + 1] - arena->offsets[i],
+                arena->min_prev_energy[i], arena->max_prev_energy[i]};
+    }
+};
+
+/** 🔹 Kernel: adds one member's min/max usage at every sample point of the sweep to min_sum/max_sum.
+ *  N is the sample count when known at compile time (the loops then unroll), 0 for any other count.
+ *  Sample points that rounding puts just outside the polygon read its nearest edge instead of failing;
+ *  unmatched lookups count as zero usage. */
+template <int N>
+static void addMemberSamples(const PolygonSpan& polygon, double member_min, double member_max, int numsamples,
+                             double* min_sum, double* max_sum) {
+    const int samples = N > 0 ? N : numsamples;
+    double member_step = (member_max - member_min) / (samples - 1);
+    PolygonView view(polygon.points, polygon.count);
+
+    if (view.valid()) {
+        double first = view.x(0), last = view.x(view.size() - 1);
+        for (int j = 0; j < samples; j++) {
+            double dependency_value = min(max(member_min + j * member_step, first), last);
+            double min_energy, max_energy;
+            if (!view.lookup(dependency_value, min_energy, max_energy)) min_energy = max_energy = 0.0;
+            min_sum[j] += min_energy;
+            max_sum[j] += max_energy;
+        }
+        return;
+    }
+
+    // Points not laid out as min/max pairs, use the general scan
+    vector<Point> points(polygon.points, polygon.points + polygon.count);
+    for (int j = 0; j < samples; j++) {
+        double min_energy, max_energy;
+        if (!DFO_Aggregation::findOrInterpolate(points, member_min + j * member_step, min_energy, max_energy)) {
+            min_energy = max_energy = 0.0;
+        }
+        min_sum[j] += min_energy;
+        max_sum[j] += max_energy;
+    }
+}
+
+/** 🔹 Kernel: the general case of one aggregated timestep. Members are visited one at a time, each
+ *  accumulating into every sample, which keeps the summation order of the sample by sample loop.
+ *  Returns the number of polygon lookups done, one per sample of every member that is not padding. */
+template <int N>
+static long long sweepSamples(const vector<PolygonSpan>& current, const vector<double>& member_min, const vector<double>& member_max,
+                         double aggregated_min_prev, double aggregated_max_prev, int numsamples,
+                         vector<double>& scratch, vector<Point>& points) {
+    const int samples = N > 0 ? N : numsamples;
+    array<double, (N > 0 ? N : 1)> fixed_min, fixed_max;
+    double* min_sum = N > 0 ? fixed_min.data() : scratch.data();
+    double* max_sum = N > 0 ? fixed_max.data() : scratch.data() + samples;
+    fill(min_sum, min_sum + samples, 0.0);
+    fill(max_sum, max_sum + samples, 0.0);
+
+    long long lookups = 0;
+    for (size_t m = 0; m < current.size(); m++) {
+        if (current[m].count == 0) continue; // Padding has zero usage
+        addMemberSamples<N>(current[m], member_min[m], member_max[m], numsamples, min_sum, max_sum);
+        lookups += samples;
+    }
+
+    double step = (aggregated_max_prev - aggregated_min_prev) / (samples - 1);
+    for (int j = 0; j < samples; j++) {
+        double current_prev_energy = aggregated_min_prev + j * step;
+        points.emplace_back(current_prev_energy, min_sum[j]);
+        points.emplace_back(current_prev_energy, max_sum[j]);
+    }
+    return lookups;
+}
+
+/** 🔹 Aggregates the members in a single sweep over their common timeline into out.
+ *  Padding is virtual: a member contributes zero usage before its start (the start padding of agg2to1) and
+ *  keeps its total energy range with zero usage after its end (the end padding), so no polygons are built for it.
+ *  With two members this is exactly agg2to1, with all of them the aggnto1 fold. */
+static void aggregateMembers(const vector<MemberPolygons>& members, int numsamples, int resolution, PolygonArena& out) {
+    INSTRUMENT_SCOPE("aggregate_sweep");
+    size_t n = members.size();
+
+    // Align every member on the timeline starting at the earliest start time
+    time_t start_time = members[0].earliest_start();
+    for (const MemberPolygons& member : members) start_time = min(start_time, member.earliest_start());
+
+    vector<int> pad_start(n);
+    int max_length = 0;
+    vector<double> end_min(n), end_max(n); // Dependency range of the (virtual) end padding
+
+    for (size_t m = 0; m < n; m++) {
+        pad_start[m] = static_cast<int>((members[m].earliest_start() - start_time) / resolution);
+        max_length = max(max_length, pad_start[m] + static_cast<int>(members[m].size()));
+
+        end_min[m] = numeric_limits<double>::max();
+        end_max[m] = numeric_limits<double>::lowest();
+        if (members[m].size() == 0) continue;
+        PolygonSpan last = members[m].at(members[m].size() - 1);
+        for (size_t k = 0; k < last.count; k++) {
+            end_min[m] = min(end_min[m], last.points[k].x + last.points[k].y);
+            end_max[m] = max(end_max[m], last.points[k].x + last.points[k].y);
+        }
+    }
+
+    out.clear();
+    out.earliest_start = start_time;
+    out.reserve(max_length, static_cast<size_t>(max_length) * 2 * numsamples);
+
+    // Per member state for the current timestep: its polygon, or no points while padding
+    vector<PolygonSpan> current(n);
+    vector<double> member_min(n), member_max(n);
+    vector<double> scratch(2 * max(numsamples, 0)); // Sample sums for counts without a specialized kernel
+    long long lookups = 0;
 
     for (int i = 0; i < max_length; i++) {
-        const DependencyPolygon& polygon1 = padded_polygons_1[i];
-        const DependencyPolygon& polygon2 = padded_polygons_2[i];
+        double aggregated_min_prev = 0.0;
+        double aggregated_max_prev = 0.0;
+        bool all_two_points = true; // Start padding and degenerate polygons have two points, end padding has four
+
+        for (size_t m = 0; m < n; m++) {
+            int local = i - pad_start[m];
+            int size = static_cast<int>(members[m].size());
+            current[m].count = 0;
+
+            if (local < 0 || size == 0) { // Start padding: zero dependency, zero usage
+                member_min[m] = 0.0;
+                member_max[m] = 0.0;
+            } else if (local >= size) { // End padding: keeps the total energy, zero usage
+                member_min[m] = end_min[m];
+                member_max[m] = end_max[m];
+                all_two_points = false;
+            } else {
+                current[m] = members[m].at(local);
+                member_min[m] = current[m].min_prev_energy;
+                member_max[m] = current[m].max_prev_energy;
+                if (current[m].count != 2) all_two_points = false;
+            }
 
-        double aggregated_min_prev = polygon1.min_prev_energy + polygon2.min_prev_energy;
-        double aggregated_max_prev = polygon1.max_prev_energy + polygon2.max_prev_energy;
+            aggregated_min_prev += member_min[m];
+            aggregated_max_prev += member_max[m];
+        }
 
-        DependencyPolygon aggregated_polygon(aggregated_min_prev, aggregated_max_prev, numsamples);
+        out.addPolygon(aggregated_min_prev, aggregated_max_prev);
 
-        if (polygon1.points.size() == 2 && polygon2.points.size() == 2) {
-            // Special case: only two points (e.g., first timestep with min/max at 0)
-            double min_current_energy = polygon1.points[0].y + polygon2.points[0].y;
-            double max_current_energy = polygon1.points[1].y + polygon2.points[1].y;
-            double dependency_amount = polygon1.points[1].x + polygon2.points[1].x;
+        if (all_two_points) {
+            // Special case: every member has only two points (e.g., first timestep with min/max at 0)
+            double min_current_energy = 0.0, max_current_energy = 0.0, dependency_amount = 0.0;
+            for (size_t m = 0; m < n; m++) {
+                if (current[m].count == 0) continue; // Start padding adds nothing
+                min_current_energy += current[m].points[0].y;
+                max_current_energy += current[m].points[1].y;
+                dependency_amount += current[m].points[1].x;
+            }
 
-            aggregated_polygon.add_point(dependency_amount, min_current_energy);
-            aggregated_polygon.add_point(dependency_amount, max_current_energy);
+            out.points.emplace_back(dependency_amount, min_current_energy);
+            out.points.emplace_back(dependency_amount, max_current_energy);
 
         } else {
-            // General case: Iterate from min dependency to max dependency
-            double step1 = (polygon1.max_prev_energy - polygon1.min_prev_energy) / (numsamples - 1);
-            double step2 = (polygon2.max_prev_energy - polygon2.min_prev_energy) / (numsamples - 1);
-            double step = (aggregated_max_prev - aggregated_min_prev) / (numsamples - 1);
-
-            for (int j = 0; j < numsamples; j++) {
-                double current_prev_energy1 = polygon1.min_prev_energy + j * step1;
-                double current_prev_energy2 = polygon2.min_prev_energy + j * step2;
-                double current_prev_energy = aggregated_min_prev + j * step;
-
-                // Find or interpolate min/max energy usage for DFO1
-                auto matching_points1 = findOrInterpolatePoints(polygon1.points, current_prev_energy1);
-                double dfo1_min_energy = matching_points1[0].y;
-                double dfo1_max_energy = matching_points1[1].y;
-
-                // Find or interpolate min/max energy usage for DFO2
-                auto matching_points2 = findOrInterpolatePoints(polygon2.points, current_prev_energy2);
-                double dfo2_min_energy = matching_points2[0].y;
-                double dfo2_max_energy = matching_points2[1].y;
-
-                // Aggregate min/max energy
-                double min_current_energy = dfo1_min_energy + dfo2_min_energy;
-                double max_current_energy = dfo1_max_energy + dfo2_max_energy;
-
-                aggregated_polygon.add_point(current_prev_energy, min_current_energy);
-                aggregated_polygon.add_point(current_prev_energy, max_current_energy);
+            // General case: sweep the sample points once, summing every member's min/max usage
+            switch (numsamples) {
+                case 5: lookups += sweepSamples<5>(current, member_min, member_max, aggregated_min_prev, aggregated_max_prev, numsamples, scratch, out.points); break;
+                case 10: lookups += sweepSamples<10>(current, member_min, member_max, aggregated_min_prev, aggregated_max_prev, numsamples, scratch, out.points); break;
+                default: lookups += sweepSamples<0>(current, member_min, member_max, aggregated_min_prev, aggregated_max_prev, numsamples, scratch, out.points); break;
             }
         }
 
-        aggregated_polygons.push_back(aggregated_polygon);
+        out.endPolygon();
     }
 
-    DFO aggregated_DFO = DFO(-1, {0}, {0}, numsamples, 0.0, -1, -1, start_time);
-    aggregated_DFO.polygons = aggregated_polygons;
-    return aggregated_DFO;
+    INSTRUMENT_COUNT("aggregate_sweep", "points", out.points.size());
+    INSTRUMENT_COUNT("aggregate_sweep", "lookups", lookups);
+    for (size_t m = 0; m < n; m++) INSTRUMENT_COUNT("aggregate_sweep", "virtual_padding", max_length - static_cast<int>(members[m].size()));
+}
+
+/** 🔹 Function: Aggregates two DFOs into one, handling misaligned start times with virtual padding. */
+DFO DFO_Aggregation::agg2to1(const DFO& dfo1, const DFO& dfo2, int numsamples, int resolution) {
+    INSTRUMENT_SCOPE("agg2to1");
+    checkResolution(resolution);
+    PolygonArena aggregate;
+    aggregateMembers({MemberPolygons(dfo1), MemberPolygons(dfo2)}, numsamples, resolution, aggregate);
+    return aggregate.toDFO(numsamples);
 }
 
-/** 🔹 Aggregates multiple DFOs into one using accumulating pairwise aggregation */
-DFO DFO_Aggregation::aggnto1(const vector<DFO>& dfos, int numsamples) {
+/** 🔹 Aggregates multiple DFOs into one using accumulating pairwise aggregation.
+ *  The running aggregate lives in two arenas used in turn, so the fold allocates no per step DFOs. */
+DFO DFO_Aggregation::aggnto1(const vector<DFO>& dfos, int numsamples, int resolution) {
+    INSTRUMENT_SCOPE("aggnto1");
+    checkResolution(resolution);
     if (dfos.empty()) {
         throw runtime_error("No DFOs provided for aggregation. Kind Regards, aggnto1 function");
     }
+    if (dfos.size() == 1) return dfos[0];
 
-    // Start aggregation with the first DFO
-    DFO aggregated_dfo = dfos[0];
+    PolygonArena aggregated, next;
+    aggregateMembers({MemberPolygons(dfos[0]), MemberPolygons(dfos[1])}, numsamples, resolution, aggregated);
 
     // Aggregate subsequent DFOs
-    for (size_t i = 1; i < dfos.size(); i++) {
-        aggregated_dfo = agg2to1(aggregated_dfo, dfos[i], numsamples);
+    for (size_t i = 2; i < dfos.size(); i++) {
+        aggregateMembers({MemberPolygons(aggregated), MemberPolygons(dfos[i])}, numsamples, resolution, next);
+        swap(aggregated, next);
+    }
+
+    return aggregated.toDFO(numsamples);
+}
+
+/** 🔹 Aggregates multiple DFOs into one in a single sweep over a common timeline, without intermediate DFOs.
+ *  Produces the same polygons as the aggnto1 fold. */
+DFO DFO_Aggregation::aggnto1_kway(const vector<DFO>& dfos, int numsamples, int resolution) {
+    INSTRUMENT_SCOPE("aggnto1_kway");
+    checkResolution(resolution);
+    if (dfos.empty()) {
+        throw runtime_error("No DFOs provided for aggregation. Kind Regards, aggnto1_kway function");
+    }
+
+    vector<MemberPolygons> members;
+    members.reserve(dfos.size());
+    for (const DFO& dfo : dfos) members.emplace_back(dfo);
+
+    PolygonArena aggregate;
+    aggregateMembers(members, numsamples, resolution, aggregate);
+    return aggregate.toDFO(numsamples);
+}
+
+/** 🔹 Aggregates multiple DFOs into one using a balanced pairwise (tree) reduction on num_threads threads */
+DFO DFO_Aggregation::aggnto1_parallel(const vector<DFO>& dfos, int numsamples, int num_threads, int resolution) {
+    INSTRUMENT_SCOPE("aggnto1_parallel");
+    checkResolution(resolution);
+    if (dfos.empty()) {
+        throw runtime_error("No DFOs provided for aggregation. Kind Regards, aggnto1_parallel function");
+    }
+
+    // Each level aggregates neighbours (0,1), (2,3), ... - an odd one out is carried to the next level as is
+    vector<const DFO*> current;
+    current.reserve(dfos.size());
+    for (const DFO& dfo : dfos) current.push_back(&dfo);
+
+    vector<unique_ptr<DFO>> owned; // Keeps the previous level alive while the next one is built
+
+    while (current.size() > 1) {
+        size_t num_pairs = current.size() / 2;
+        vector<unique_ptr<DFO>> next_owned(num_pairs);
+
+        parallel_for(num_pairs, num_threads, [&](size_t k) {
+            next_owned[k].reset(new DFO(agg2to1(*current[2 * k], *current[2 * k + 1], numsamples, resolution)));
+        });
+
+        vector<const DFO*> next;
+        next.reserve(num_pairs + 1);
+        for (const auto& dfo : next_owned) next.push_back(dfo.get());
+
+        if (current.size() % 2 == 1) {
+            // Carry the leftover, taking its ownership along if the previous level produced it
+            if (!owned.empty()) next_owned.push_back(move(owned.back()));
+            next.push_back(current.back());
+        }
+
+        owned = move(next_owned);
+        current = move(next);
+    }
+
+    return *current[0];
+}
+
+/** 🔹 Helper: max-flow network (Dinic) over real valued capacities, used to plan a disaggregation. */
+struct FlowNetwork {
+    struct Edge {
+        int to;
+        double capacity; // Residual capacity; edge e ^ 1 is the reverse of edge e
+    };
+
+    static constexpr double EPSILON = 1e-9; // Residual capacities below this count as saturated
+
+    vector<Edge> edges;
+    vector<vector<int>> adjacency;
+    vector<int> level;
+    vector<size_t> next_edge;
+
+    explicit FlowNetwork(int num_nodes) : adjacency(num_nodes), level(num_nodes), next_edge(num_nodes) {}
+
+    int addEdge(int from, int to, double capacity) {
+        adjacency[from].push_back(static_cast<int>(edges.size()));
+        edges.push_back({to, capacity});
+        adjacency[to].push_back(static_cast<int>(edges.size()));
+        edges.push_back({from, 0.0});
+        return static_cast<int>(edges.size()) - 2;
+    }
+
+    double flowOn(int edge) const { return edges[edge ^ 1].capacity; }
+
+    bool buildLevels(int source, int sink) {
+        fill(level.begin(), level.end(), -1);
+        vector<int> queue{source};
+        level[source] = 0;
+        for (size_t q = 0; q < queue.size(); q++) {
+            for (int e : adjacency[queue[q]]) {
+                if (edges[e].capacity > EPSILON && level[edges[e].to] < 0) {
+                    level[edges[e].to] = level[queue[q]] + 1;
+                    queue.push_back(edges[e].to);
+                }
+            }
+        }
+        return level[sink] >= 0;
+    }
+
+    // Pushes up to limit from node to sink along level edges, over as many paths as it takes
+    double augment(int node, int sink, double limit) {
+        if (node == sink) return limit;
+        double total = 0.0;
+        for (size_t& k = next_edge[node]; k < adjacency[node].size(); k++) {
+            Edge& edge = edges[adjacency[node][k]];
+            if (edge.capacity <= EPSILON || level[edge.to] != level[node] + 1) continue;
+            double pushed = augment(edge.to, sink, min(limit - total, edge.capacity));
+            if (pushed > EPSILON) {
+                edge.capacity -= pushed;
+                edges[adjacency[node][k] ^ 1].capacity += pushed;
+                total += pushed;
+                if (limit - total <= EPSILON) break; // Keep the edge, it may still carry more
+            }
+        }
+        return total;
+    }
+
+    double maxFlow(int source, int sink) {
+        double total = 0.0;
+        while (buildLevels(source, sink)) {
+            fill(next_edge.begin(), next_edge.end(), 0);
+            for (double pushed; (pushed = augment(source, sink, numeric_limits<double>::infinity())) > EPSILON;) {
+                total += pushed;
+            }
+        }
+        return total;
+    }
+};
+
+/** 🔹 Helper function: Visits the dependency values in [lo, hi] where the usage bounds of a polygon may bend, in
+ *  increasing order, with the bounds there. The bounds are linear in between. Points are sorted by x, as in usageAt. */
+template <typename Visit>
+static void forBreakpoints(const DependencyPolygon& polygon, double lo, double hi, Visit visit) {
+    double min_usage, max_usage;
+    DFO_Aggregation::usageAt(polygon, lo, min_usage, max_usage);
+    visit(lo, min_usage, max_usage);
+    double previous = lo;
+    for (const Point& p : polygon.points) {
+        if (p.x <= previous || p.x >= hi) continue;
+        DFO_Aggregation::usageAt(polygon, p.x, min_usage, max_usage);
+        visit(p.x, min_usage, max_usage);
+        previous = p.x;
+    }
+    if (hi > lo) {
+        DFO_Aggregation::usageAt(polygon, hi, min_usage, max_usage);
+        visit(hi, min_usage, max_usage);
+    }
+}
+
+/** 🔹 Helper function: Range of usages and of energies after the timestep of a polygon, from energies in [lo, hi]. */
+static void reachable(const DependencyPolygon& polygon, double lo, double hi, double& min_usage, double& max_usage,
+                      double& min_energy, double& max_energy) {
+    min_usage = min_energy = numeric_limits<double>::max();
+    max_usage = max_energy = numeric_limits<double>::lowest();
+    forBreakpoints(polygon, lo, hi, [&](double x, double lower, double upper) {
+        min_usage = min(min_usage, lower);
+        max_usage = max(max_usage, upper);
+        min_energy = min(min_energy, x + lower);
+        max_energy = max(max_energy, x + upper);
+    });
+}
+
+/** 🔹 Helper function: Narrows [lo, hi] to the hull of the energies x before the timestep of a polygon for which
+ *  slope * x + usage can land in [target_lo, target_hi]: slope 0 bounds the usage, slope 1 the energy after it.
+ *  Returns false if there are none. */
+static bool narrowToReaching(const DependencyPolygon& polygon, double slope, double target_lo, double target_hi,
+                             double& lo, double& hi) {
+    target_lo -= 1e-9 * (1.0 + fabs(target_lo));
+    target_hi += 1e-9 * (1.0 + fabs(target_hi));
+    double first = numeric_limits<double>::max(), last = numeric_limits<double>::lowest();
+    bool started = false;
+    double x0 = lo, min0 = 0.0, max0 = 0.0;
+    forBreakpoints(polygon, lo, hi, [&](double x1, double min1, double max1) {
+        if (!started) { // A single value forms a segment of its own
+            x0 = x1;
+            min0 = min1;
+            max0 = max1;
+            started = true;
+        }
+        // Between x0 and x1 the lowest and highest values reached are linear in x,
+        // so the energies that can still land in the target form one interval there
+        double from = 0.0, to = 1.0;
+        auto atMost = [&](double v0, double v1, double bound) { // Keeps the t in [0, 1] with v0 + t (v1 - v0) <= bound
+            if (v1 == v0) {
+                if (v0 > bound) to = -1.0;
+            } else if (v1 > v0) {
+                to = min(to, (bound - v0) / (v1 - v0));
+            } else {
+                from = max(from, (bound - v0) / (v1 - v0));
+            }
+        };
+        atMost(slope * x0 + min0, slope * x1 + min1, target_hi);
+        atMost(-(slope * x0 + max0), -(slope * x1 + max1), -target_lo);
+        if (from <= to) {
+            first = min(first, x0 + from * (x1 - x0));
+            last = max(last, x0 + to * (x1 - x0));
+        }
+        x0 = x1;
+        min0 = min1;
+        max0 = max1;
+    });
+    if (first > last) return false;
+    lo = max(lo, first);
+    hi = min(hi, last);
+    return true;
+}
+
+/** 🔹 Helper function: Intersects [lo, hi] with [new_lo, new_hi], noting in changed whether it shrank by more than
+ *  slack (by default relative to the bounds). Returns false if they do not overlap; bounds that only cross by
+ *  rounding meet halfway. */
+static bool narrow(double& lo, double& hi, double new_lo, double new_hi, bool& changed, double slack = 0.0) {
+    slack = max(slack, 1e-9 * (1.0 + fabs(lo) + fabs(hi)));
+    if (new_lo > lo + slack || new_hi < hi - slack) changed = true;
+    lo = max(lo, new_lo);
+    hi = min(hi, new_hi);
+    if (lo > hi + slack) return false;
+    if (lo > hi) lo = hi = (lo + hi) / 2.0;
+    return true;
+}
+
+/** 🔹 Helper function: Plans the usage of every member from timestep `from` on, starting from the members' known
+ *  energy. Every member step is given interval bounds on its energy and usage, narrowed until they agree with the
+ *  member's polygons, the totals of its last polygon and the aggregate usage of every timestep. The rest of the
+ *  horizon is then solved as a feasible flow: every timestep supplies its aggregate usage to the members active in
+ *  it, and each member carries its energy from one timestep to the next within those bounds.
+ *  Writes two splits of timestep `from`, both within the interpolated bounds at the known energy: the one of the
+ *  flow, and a central one taking the same share of every member's usage bounds. Returns false if the bounds are
+ *  empty or the flow does not exist. */
+static bool planDisaggregation(const vector<DFO>& dfos, const vector<int>& pad_start, const vector<double>& aggregate_usage,
+                               int from, const vector<double>& energy, vector<double>& flow_split, vector<double>& central_split) {
+    int max_length = static_cast<int>(aggregate_usage.size());
+    size_t n = dfos.size();
+    vector<int> first_k(n);
+    vector<vector<int>> active(max_length); // Planned members in every timestep
+    for (size_t m = 0; m < n; m++) {
+        first_k[m] = min(max(from - pad_start[m], 0), static_cast<int>(dfos[m].polygons.size()));
+        for (size_t k = first_k[m]; k < dfos[m].polygons.size(); k++) active[pad_start[m] + k].push_back(static_cast<int>(m));
+    }
+
+    // Energy before every member step (and, at the end, after the last one) and usage in it
+    vector<vector<double>> energy_lo(n), energy_hi(n), usage_lo(n), usage_hi(n);
+    for (size_t m = 0; m < n; m++) {
+        const vector<DependencyPolygon>& polygons = dfos[m].polygons;
+        size_t count = polygons.size();
+        energy_lo[m].assign(count + 1, numeric_limits<double>::lowest());
+        energy_hi[m].assign(count + 1, numeric_limits<double>::max());
+        usage_lo[m].assign(count, numeric_limits<double>::lowest());
+        usage_hi[m].assign(count, numeric_limits<double>::max());
+        if (static_cast<size_t>(first_k[m]) == count) continue;
+
+        energy_lo[m][first_k[m]] = energy_hi[m][first_k[m]] = energy[m];
+        for (size_t k = first_k[m]; k < count; k++) {
+            if (static_cast<int>(k) > first_k[m]) {
+                energy_lo[m][k] = polygons[k].min_prev_energy;
+                energy_hi[m][k] = polygons[k].max_prev_energy;
+            }
+            usage_lo[m][k] = usage_hi[m][k] = 0.0;
+            for (size_t j = 0; j < polygons[k].points.size(); j++) {
+                const Point& p = polygons[k].points[j];
+                usage_lo[m][k] = j == 0 ? p.y : min(usage_lo[m][k], p.y);
+                usage_hi[m][k] = j == 0 ? p.y : max(usage_hi[m][k], p.y);
+            }
+        }
+        double min_total = numeric_limits<double>::max(), max_total = numeric_limits<double>::lowest();
+        for (const Point& p : polygons.back().points) {
+            min_total = min(min_total, p.x + p.y);
+            max_total = max(max_total, p.x + p.y);
+        }
+        if (polygons.back().points.empty()) min_total = max_total = polygons.back().min_prev_energy;
+        energy_lo[m][count] = min_total;
+        energy_hi[m][count] = max_total;
+    }
+
+    bool changed = true;
+    for (int round = 0; changed && round < 16; round++) {
+        changed = false;
+        for (size_t m = 0; m < n; m++) {
+            const vector<DependencyPolygon>& polygons = dfos[m].polygons;
+            vector<double>& e_lo = energy_lo[m];
+            vector<double>& e_hi = energy_hi[m];
+            vector<double>& u_lo = usage_lo[m];
+            vector<double>& u_hi = usage_hi[m];
+            for (size_t k = first_k[m]; k < polygons.size(); k++) { // Forward: what the member can reach
+                double min_usage, max_usage, min_energy, max_energy;
+                reachable(polygons[k], e_lo[k], e_hi[k], min_usage, max_usage, min_energy, max_energy);
+                if (!narrow(u_lo[k], u_hi[k], min_usage, max_usage, changed) ||
+                    !narrow(e_lo[k + 1], e_hi[k + 1], min_energy, max_energy, changed) ||
+                    !narrow(e_lo[k + 1], e_hi[k + 1], e_lo[k] + u_lo[k], e_hi[k] + u_hi[k], changed)) {
+                    return false;
+                }
+            }
+            for (size_t k = polygons.size(); k-- > static_cast<size_t>(first_k[m]);) { // Backward: what it still has to reach
+                double lo = e_lo[k], hi = e_hi[k];
+                if (!narrow(u_lo[k], u_hi[k], e_lo[k + 1] - e_hi[k], e_hi[k + 1] - e_lo[k], changed) ||
+                    !narrowToReaching(polygons[k], 1.0, e_lo[k + 1], e_hi[k + 1], lo, hi) ||
+                    !narrowToReaching(polygons[k], 0.0, u_lo[k], u_hi[k], lo, hi) ||
+                    !narrow(e_lo[k], e_hi[k], lo, hi, changed)) {
+                    return false;
+                }
+            }
+        }
+
+        for (int i = from; i < max_length; i++) { // Every member takes what the others leave of the aggregate usage
+            double sum_lo = 0.0, sum_hi = 0.0;
+            for (int m : active[i]) {
+                sum_lo += usage_lo[m][i - pad_start[m]];
+                sum_hi += usage_hi[m][i - pad_start[m]];
+            }
+            double slack = 1e-9 * (1.0 + fabs(sum_lo) + fabs(sum_hi) + fabs(aggregate_usage[i])); // Rounding of the sums
+            for (int m : active[i]) {
+                double& lo = usage_lo[m][i - pad_start[m]];
+                double& hi = usage_hi[m][i - pad_start[m]];
+                if (!narrow(lo, hi, aggregate_usage[i] - (sum_hi - hi), aggregate_usage[i] - (sum_lo - lo), changed, slack)) {
+                    return false;
+                }
+            }
+        }
+    }
+
+    double sum_lo = 0.0, sum_hi = 0.0;
+    for (int m : active[from]) {
+        sum_lo += usage_lo[m][from - pad_start[m]];
+        sum_hi += usage_hi[m][from - pad_start[m]];
+    }
+    double share = sum_hi > sum_lo ? min(max((aggregate_usage[from] - sum_lo) / (sum_hi - sum_lo), 0.0), 1.0) : 0.0;
+    for (int m : active[from]) {
+        size_t k = static_cast<size_t>(from - pad_start[m]);
+        central_split[m] = usage_lo[m][k] + share * (usage_hi[m][k] - usage_lo[m][k]);
+    }
+
+    // Nodes: source, sink, the super source/sink for the lower bounds, one per timestep and one per member
+    // timestep. Node (m, k) receives the member's energy before timestep k and its usage in it.
+    const int source = 0, sink = 1, super_source = 2, super_sink = 3, first_step = 4 - from;
+    vector<int> first_node(n);
+    int num_nodes = 4 + max_length - from;
+    for (size_t m = 0; m < n; m++) {
+        first_node[m] = num_nodes - first_k[m];
+        num_nodes += static_cast<int>(dfos[m].polygons.size()) - first_k[m];
+    }
+
+    FlowNetwork network(num_nodes);
+    vector<double> excess(num_nodes, 0.0);
+    auto addBounded = [&](int from, int to, double lower, double upper) {
+        excess[from] -= lower;
+        excess[to] += lower;
+        return network.addEdge(from, to, max(upper - lower, 0.0));
+    };
+
+    for (int i = from; i < max_length; i++) {
+        addBounded(source, first_step + i, aggregate_usage[i], aggregate_usage[i]);
+    }
+
+    vector<vector<int>> usage_edges(n);
+    for (size_t m = 0; m < n; m++) {
+        size_t count = dfos[m].polygons.size();
+        usage_edges[m].resize(count);
+        for (size_t k = first_k[m]; k < count; k++) {
+            int node = first_node[m] + static_cast<int>(k);
+            if (static_cast<int>(k) == first_k[m]) addBounded(source, node, energy[m], energy[m]);
+            usage_edges[m][k] = addBounded(first_step + pad_start[m] + static_cast<int>(k), node, usage_lo[m][k], usage_hi[m][k]);
+            addBounded(node, k + 1 < count ? node + 1 : sink, energy_lo[m][k + 1], energy_hi[m][k + 1]);
+        }
+    }
+    network.addEdge(sink, source, numeric_limits<double>::infinity());
+
+    double required = 0.0;
+    for (int v = 0; v < num_nodes; v++) {
+        if (excess[v] > 0.0) {
+            network.addEdge(super_source, v, excess[v]);
+            required += excess[v];
+        } else if (excess[v] < 0.0) {
+            network.addEdge(v, super_sink, -excess[v]);
+        }
+    }
+    if (network.maxFlow(super_source, super_sink) < required - 1e-6 * (1.0 + required)) return false;
+
+    for (int m : active[from]) {
+        size_t k = static_cast<size_t>(from - pad_start[m]);
+        flow_split[m] = usage_lo[m][k] + network.flowOn(usage_edges[m][k]);
+    }
+    return true;
+}
+
+/** 🔹 Disaggregates an aggregate trajectory timestep by timestep, keeping every member step within the interpolated
+ *  min/max usage of its polygon at the member's actual dependency value. Each timestep takes the central split if
+ *  the rest of the horizon can still be planned after it, and the split of the flow otherwise.
+ *  Throws if no split reproduces the aggregate trajectory within the dependency polygons. */
+vector<vector<double>> DFO_Aggregation::disaggregate(const vector<DFO>& dfos, const vector<double>& aggregate_usage, int resolution) {
+    INSTRUMENT_SCOPE("disaggregate");
+    if (dfos.empty()) {
+        throw runtime_error("No DFOs provided for disaggregation. Kind Regards, disaggregate function");
+    }
+
+    time_t start_time;
+    vector<int> pad_start;
+    int max_length;
+    alignDFOs(dfos, start_time, pad_start, max_length, resolution);
+
+    if (static_cast<int>(aggregate_usage.size()) != max_length) {
+        throw invalid_argument("aggregate_usage must hold one value per timestep of the aggregated DFO.");
+    }
+
+    size_t n = dfos.size();
+    vector<vector<double>> trajectories(n);
+    vector<vector<int>> active(max_length); // Members in every timestep
+    vector<double> energy(n);               // Energy of every member before the current timestep
+    for (size_t m = 0; m < n; m++) {
+        trajectories[m].resize(dfos[m].polygons.size());
+        for (size_t k = 0; k < dfos[m].polygons.size(); k++) active[pad_start[m] + k].push_back(static_cast<int>(m));
+        energy[m] = dfos[m].polygons.empty() ? 0.0 : dfos[m].polygons[0].min_prev_energy;
+    }
+
+    const char* infeasible = "aggregate_usage cannot be split within the dependency polygons of the member DFOs. "
+                             "Kind Regards, disaggregate function";
+    vector<double> flow_split(n), central_split(n), next_flow(n), next_central(n), next_energy;
+    long long plans = 1;
+    if (!planDisaggregation(dfos, pad_start, aggregate_usage, 0, energy, flow_split, central_split)) {
+        throw invalid_argument(infeasible);
+    }
+
+    for (int i = 0; i < max_length; i++) {
+        bool last = i + 1 == max_length;
+        next_energy = energy;
+        for (int m : active[i]) next_energy[m] += central_split[m];
+        plans += !last;
+        const vector<double>* split = &central_split;
+        if (!last && !planDisaggregation(dfos, pad_start, aggregate_usage, i + 1, next_energy, next_flow, next_central)) {
+            // The central split leaves no room for the rest of the horizon, take the split of the flow instead
+            split = &flow_split;
+            next_energy = energy;
+            for (int m : active[i]) next_energy[m] += flow_split[m];
+            plans++;
+            if (!planDisaggregation(dfos, pad_start, aggregate_usage, i + 1, next_energy, next_flow, next_central)) {
+                throw invalid_argument(infeasible);
+            }
+        }
+
+        double member_sum = 0.0;
+        for (int m : active[i]) {
+            size_t k = static_cast<size_t>(i - pad_start[m]);
+            double usage = (*split)[m], min_usage, max_usage;
+            usageAt(dfos[m].polygons[k], energy[m], min_usage, max_usage);
+            if (usage < min_usage - 1e-6 * (1.0 + fabs(min_usage)) || usage > max_usage + 1e-6 * (1.0 + fabs(max_usage))) {
+                throw runtime_error("A member step leaves its dependency polygon. Kind Regards, disaggregate function");
+            }
+            trajectories[m][k] = usage;
+            member_sum += usage;
+        }
+        // The member trajectories must add up to the aggregate one
+        if (fabs(member_sum - aggregate_usage[i]) > 1e-6 * (1.0 + fabs(aggregate_usage[i]))) {
+            throw runtime_error("Member trajectories do not add up to aggregate_usage. Kind Regards, disaggregate function");
+        }
+
+        energy = move(next_energy);
+        swap(flow_split, next_flow);
+        swap(central_split, next_central);
     }
+    INSTRUMENT_COUNT("disaggregate", "plans", plans);
 
-    return aggregated_dfo;
+    return trajectories;
 }
@@ -0,0 +1,129 @@
+#include "../include/DFO_batch.h"
+#include "../include/instrumentation.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/** 🔹 Kernel: fills sample i of every polygon. Branch free over contiguous arrays, so the compiler can vectorize it. */
+static void generate_samples(size_t num_polygons, double i,
+                             const double* min_prev, const double* step,
+                             const double* next_min_prev, const double* next_max_prev, const double* power,
+                             double* x, double* y_min, double* y_max) {
+    for (size_t p = 0; p < num_polygons; p++) {
+        double current_prev_energy = min_prev[p] + i * step[p];
+        double min_current_energy = max(next_min_prev[p] - current_prev_energy, 0.0);
+        double max_current_energy = max(next_max_prev[p] - current_prev_energy, 0.0);
+        x[p] = current_prev_energy;
+        y_min[p] = min(min_current_energy, power[p]); // Limit to charging power
+        y_max[p] = min(max_current_energy, power[p]); // Limit to charging power
+    }
+}
+
+DependencyPolygonBatch generate_dependency_polygons_batch(const vector<vector<double>>& min_prev,
+                                                          const vector<vector<double>>& max_prev,
+                                                          int numsamples,
+                                                          const vector<double>& charging_power) {
+    INSTRUMENT_SCOPE("generate_dependency_polygons_batch");
+    if (min_prev.size() != max_prev.size()) {
+        throw invalid_argument("min_prev and max_prev must describe the same number of DFOs.");
+    }
+    if (charging_power.size() != 1 && charging_power.size() != min_prev.size()) {
+        throw invalid_argument("charging_power must hold one value per DFO or a single shared value.");
+    }
+    if (numsamples < 2) {
+        throw invalid_argument("numsamples must be at least 2.");
+    }
+
+    size_t num_dfos = min_prev.size();
+    DependencyPolygonBatch batch;
+    batch.numsamples = numsamples;
+    batch.dfo_offsets.reserve(num_dfos + 1);
+    batch.charging_power.reserve(num_dfos);
+    batch.min_total_energy.reserve(num_dfos);
+    batch.max_total_energy.reserve(num_dfos);
+    batch.dfo_offsets.push_back(0);
+
+    for (size_t d = 0; d < num_dfos; d++) {
+        if (min_prev[d].empty() || min_prev[d].size() != max_prev[d].size()) {
+            throw invalid_argument("min_prev and max_prev cannot be empty and must have the same length.");
+        }
+        // A DFO with n dependency bounds has n - 1 polygons, the last bound only constrains the one before it
+        batch.dfo_offsets.push_back(batch.dfo_offsets.back() + min_prev[d].size() - 1);
+        batch.charging_power.push_back(charging_power.size() == 1 ? charging_power[0] : charging_power[d]);
+        batch.min_total_energy.push_back(min_prev[d].back());
+        batch.max_total_energy.push_back(max_prev[d].back());
+    }
+
+    // Gather the per polygon inputs into flat arrays
+    size_t num_polygons = batch.dfo_offsets.back();
+    vector<double> step(num_polygons), next_min_prev(num_polygons), next_max_prev(num_polygons), power(num_polygons);
+    batch.min_prev_energy.resize(num_polygons);
+    batch.max_prev_energy.resize(num_polygons);
+
+    for (size_t d = 0; d < num_dfos; d++) {
+        size_t p = batch.dfo_offsets[d];
+        for (size_t t = 0; t + 1 < min_prev[d].size(); t++, p++) {
+            batch.min_prev_energy[p] = min_prev[d][t];
+            batch.max_prev_energy[p] = max_prev[d][t];
+            next_min_prev[p] = min_prev[d][t + 1];
+            next_max_prev[p] = max_prev[d][t + 1];
+            power[p] = batch.charging_power[d];
+            step[p] = (max_prev[d][t] - min_prev[d][t]) / (numsamples - 1);
+        }
+    }
+
+    // Samples are generated in ascending x order with y_min <= y_max, so no sorting is needed
+    batch.x.resize(num_polygons * numsamples);
+    batch.y_min.resize(num_polygons * numsamples);
+    batch.y_max.resize(num_polygons * numsamples);
+    for (int i = 0; i < numsamples; i++) {
+        size_t offset = i * num_polygons;
+        generate_samples(num_polygons, i, batch.min_prev_energy.data(), step.data(),
+                         next_min_prev.data(), next_max_prev.data(), power.data(),
+                         batch.x.data() + offset, batch.y_min.data() + offset, batch.y_max.data() + offset);
+    }
+
+    return batch;
+}
+
+DFO DependencyPolygonBatch::to_dfo(size_t index, int dfo_id, time_t earliest_start) const {
+    if (index >= num_dfos()) {
+        throw out_of_range("DFO index out of range.");
+    }
+
+    DFO dfo(dfo_id, {min_total_energy[index]}, {max_total_energy[index]}, numsamples, charging_power[index],
+            min_total_energy[index], max_total_energy[index], earliest_start);
+    dfo.polygons.clear();
+    dfo.polygons.reserve(dfo_offsets[index + 1] - dfo_offsets[index]);
+
+    size_t total = num_polygons();
+    for (size_t p = dfo_offsets[index]; p < dfo_offsets[index + 1]; p++) {
+        DependencyPolygon polygon(min_prev_energy[p], max_prev_energy[p], numsamples);
+        // Equal min/max dependency collapses the polygon to a single pair of points
+        int samples = (min_prev_energy[p] == max_prev_energy[p]) ? 1 : numsamples;
+        polygon.points.reserve(2 * samples);
+        for (int i = 0; i < samples; i++) {
+            polygon.add_point(x[i * total + p], y_min[i * total + p]);
+            polygon.add_point(x[i * total + p], y_max[i * total + p]);
+        }
+        dfo.polygons.push_back(move(polygon));
+    }
+
+    return dfo;
+}
+
+vector<DFO> DependencyPolygonBatch::to_dfos(const vector<int>& dfo_ids, const vector<time_t>& earliest_starts) const {
+    INSTRUMENT_SCOPE("DependencyPolygonBatch::to_dfos");
+    if (dfo_ids.size() != num_dfos() || earliest_starts.size() != num_dfos()) {
+        throw invalid_argument("dfo_ids and earliest_starts must hold one value per DFO.");
+    }
+
+    vector<DFO> dfos;
+    dfos.reserve(num_dfos());
+    for (size_t d = 0; d < num_dfos(); d++) {
+        dfos.push_back(to_dfo(d, dfo_ids[d], earliest_starts[d]));
+    }
+    return dfos;
+}
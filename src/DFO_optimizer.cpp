@@ -0,0 +1,146 @@
+#include "../include/DFO_optimizer.h"
+#include "../include/DFO_aggregation.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+static const double INFEASIBLE = numeric_limits<double>::infinity();
+static const double GRID_EPSILON = 1e-9; // In grid steps, so bounds landing on a level do not round past it
+
+/** 🔹 Helper: the energy levels of the dynamic program, evenly spaced over [lowest, lowest + step * last]. */
+struct EnergyGrid {
+    double lowest;
+    double step;
+    int last; // Index of the highest level
+
+    double energy(int k) const { return lowest + k * step; }
+    int below(double energy) const { return clamp(static_cast<int>(floor((energy - lowest) / step + GRID_EPSILON))); }
+    int above(double energy) const { return clamp(static_cast<int>(ceil((energy - lowest) / step - GRID_EPSILON))); }
+    int clamp(int k) const { return min(max(k, 0), last); }
+};
+
+/** 🔹 Helper function: the levels within [min_energy, max_energy], widened to the neighbouring levels so
+ *  ranges narrower than a grid step keep at least one level. */
+static void levelRange(const EnergyGrid& grid, double min_energy, double max_energy, int& first, int& last) {
+    first = grid.below(min_energy);
+    last = grid.above(max_energy);
+}
+
+DFOSchedule optimize_dfo(const DFO& dfo, const vector<double>& prices, time_t price_start, int resolution, int num_states) {
+    INSTRUMENT_SCOPE("optimize_dfo");
+    if (resolution <= 0) throw invalid_argument("resolution must be a positive number of seconds per timestep.");
+    if (num_states < 2) throw invalid_argument("num_states must be at least 2.");
+
+    int length = static_cast<int>(dfo.polygons.size());
+    DFOSchedule schedule{vector<double>(length, 0.0), 0.0};
+    if (length == 0) return schedule;
+
+    long long offset = static_cast<long long>(dfo.earliest_start - price_start) / resolution;
+    if (offset < 0 || offset + length > static_cast<long long>(prices.size())) {
+        throw invalid_argument("The prices do not cover the timesteps of DFO " + to_string(dfo.dfo_id) + ".");
+    }
+    const double* price = prices.data() + offset;
+
+    // The grid spans every dependency value and every total the last polygon can reach
+    EnergyGrid grid{dfo.polygons[0].min_prev_energy, 0.0, num_states - 1};
+    double highest = dfo.polygons[0].max_prev_energy;
+    for (const DependencyPolygon& polygon : dfo.polygons) {
+        grid.lowest = min(grid.lowest, polygon.min_prev_energy);
+        highest = max(highest, polygon.max_prev_energy);
+    }
+    for (const Point& point : dfo.polygons.back().points) highest = max(highest, point.x + point.y);
+    grid.step = highest > grid.lowest ? (highest - grid.lowest) / grid.last : 1.0;
+
+    // value[k]: cheapest cost from level k at the current timestep to the end; choice[t * num_states + k]: level
+    // after timestep t.
+    // Any end level is allowed, the usage bounds of the polygons already lead to the total energy.
+    vector<double> value(num_states, 0.0), next_value(num_states);
+    vector<int> choice(static_cast<size_t>(length) * num_states, -1);
+    int first, last;
+
+    vector<int> from(num_states), to(num_states);
+    deque<int> window;
+    for (int t = length - 1; t >= 0; t--) {
+        swap(value, next_value);
+        fill(value.begin(), value.end(), INFEASIBLE);
+        const DependencyPolygon& polygon = dfo.polygons[t];
+        levelRange(grid, polygon.min_prev_energy, polygon.max_prev_energy, first, last);
+
+        // Levels reachable from each level k: [from[k], to[k]]
+        bool monotone = true;
+        for (int k = first; k <= last; k++) {
+            double min_energy, max_energy;
+            DFO_Aggregation::usageAt(polygon, grid.energy(k), min_energy, max_energy);
+            from[k] = grid.below(grid.energy(k) + min_energy);
+            to[k] = grid.above(grid.energy(k) + max_energy);
+            if (k > first && (from[k] < from[k - 1] || to[k] < to[k - 1])) monotone = false;
+        }
+
+        // Cost of moving from k to j is price * (energy(j) - energy(k)), so the best j minimizes
+        // price * energy(j) + next_value[j] over the window - a sliding window minimum while the windows only move up
+        auto score = [&](int j) { return price[t] * grid.energy(j) + next_value[j]; };
+        int pushed = from[first];
+        window.clear();
+        for (int k = first; k <= last; k++) {
+            int best = -1;
+            if (monotone) {
+                if (pushed < from[k]) pushed = from[k];
+                for (; pushed <= to[k]; pushed++) {
+                    while (!window.empty() && score(window.back()) >= score(pushed)) window.pop_back();
+                    window.push_back(pushed);
+                }
+                while (!window.empty() && window.front() < from[k]) window.pop_front();
+                if (!window.empty()) best = window.front();
+            } else {
+                for (int j = from[k]; j <= to[k]; j++) {
+                    if (best < 0 || score(j) < score(best)) best = j;
+                }
+            }
+            if (best < 0 || next_value[best] == INFEASIBLE) continue;
+            value[k] = score(best) - price[t] * grid.energy(k);
+            choice[static_cast<size_t>(t) * num_states + k] = best;
+        }
+    }
+
+    // Start at the cheapest level the first polygon allows
+    levelRange(grid, dfo.polygons[0].min_prev_energy, dfo.polygons[0].max_prev_energy, first, last);
+    int level = -1;
+    for (int k = first; k <= last; k++) {
+        if (value[k] != INFEASIBLE && (level < 0 || value[k] < value[level])) level = k;
+    }
+    if (level < 0) {
+        throw runtime_error("No feasible trajectory through DFO " + to_string(dfo.dfo_id) + " on the energy grid.");
+    }
+
+    // Follow the grid path with the real bounds at the real dependency, which keeps every usage feasible
+    double dependency = min(max(grid.energy(level), dfo.polygons[0].min_prev_energy), dfo.polygons[0].max_prev_energy);
+    for (int t = 0; t < length; t++) {
+        int target = choice[static_cast<size_t>(t) * num_states + level];
+        double min_energy, max_energy;
+        DFO_Aggregation::usageAt(dfo.polygons[t], dependency, min_energy, max_energy);
+        double usage = min(max(grid.energy(target) - dependency, min_energy), max_energy);
+        schedule.usage[t] = usage;
+        schedule.cost += price[t] * usage;
+        dependency += usage;
+        level = target;
+    }
+    INSTRUMENT_COUNT("optimize_dfo", "states", static_cast<long long>(length) * num_states);
+    return schedule;
+}
+
+vector<DFOSchedule> optimize_dfos(const vector<DFO>& dfos, const vector<double>& prices, time_t price_start,
+                                  int resolution, int num_states, int num_threads) {
+    vector<DFOSchedule> schedules(dfos.size());
+    parallel_for(dfos.size(), num_threads, [&](size_t i) {
+        schedules[i] = optimize_dfo(dfos[i], prices, price_start, resolution, num_states);
+    });
+    return schedules;
+}
@@ -0,0 +1,250 @@
+#include "../include/alignment.h"
+#include "../include/helpers.h"
+#include "../include/instrumentation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+
+using namespace std;
+
+/** 🔹 Helper: the members on a common slot timeline starting at the earliest EST. Member i can start at slots
+ *  [offset[i], offset[i] + flexibility[i]] and contributes mid[i][j] (mid power of slice j) to the balance.
+ *  The mid powers are also kept as runs of equal power: member i owns runs [run_offsets[i], run_offsets[i + 1]),
+ *  run r covering slices [run_start[r], end) of power run_power[r], where end is the next run's start or, for the
+ *  last run of a member, its duration. */
+struct AlignmentTimeline {
+    time_t earliest;
+    int resolution;
+    vector<int> offset;
+    vector<int> flexibility;
+    vector<vector<double>> mid;
+    vector<size_t> run_offsets{0};
+    vector<int> run_start;
+    vector<double> run_power;
+    vector<double> profile; // Running aggregate of the mid powers
+    mutable vector<double> window_prefix; // Prefix sums of the profile over the shifts of one member
+    int start_alignment_flexibility;
+
+    AlignmentTimeline(const vector<Flexoffer>& flex_offers, int slot_length) : resolution(resolve_time_resolution(slot_length)) {
+        if (flex_offers.empty()) throw invalid_argument("No flexoffers to aggregate.");
+        earliest = flex_offers[0].get_est();
+        for (const auto& fo : flex_offers) earliest = min(earliest, fo.get_est());
+
+        size_t n = flex_offers.size();
+        offset.resize(n);
+        flexibility.resize(n);
+        mid.resize(n);
+        run_offsets.reserve(n + 1);
+        start_alignment_flexibility = numeric_limits<int>::max();
+        int length = 0;
+        for (size_t i = 0; i < n; i++) {
+            const Flexoffer& fo = flex_offers[i];
+            offset[i] = static_cast<int>((fo.get_est() - earliest) / resolution);
+            flexibility[i] = max(0, static_cast<int>((fo.get_lst() - fo.get_est()) / resolution));
+            start_alignment_flexibility = min(start_alignment_flexibility, flexibility[i]);
+            for (const TimeSlice& slice : fo.get_profile_ref()) mid[i].push_back((slice.min_power + slice.max_power) / 2.0);
+            for (size_t j = 0; j < mid[i].size(); j++) {
+                if (j == 0 || mid[i][j] != mid[i][j - 1]) {
+                    run_start.push_back(static_cast<int>(j));
+                    run_power.push_back(mid[i][j]);
+                }
+            }
+            run_offsets.push_back(run_power.size());
+            length = max(length, offset[i] + flexibility[i] + static_cast<int>(mid[i].size()));
+        }
+        profile.assign(length, 0.0);
+    }
+
+    void place(size_t i, int shift, double sign) {
+        double* window = profile.data() + offset[i] + shift;
+        for (size_t j = 0; j < mid[i].size(); j++) window[j] += sign * mid[i][j];
+    }
+
+    // Runs pay off when the profile is mostly flat; otherwise the plain dot product is cheaper
+    bool scoreByRuns(size_t i) const { return 2 * (run_offsets[i + 1] - run_offsets[i]) <= mid[i].size(); }
+
+    // Change of the squared profile, sum((p + c)^2 - p^2), less the constant sum(c^2): twice the overlap of the
+    // member with its window of the running profile. By runs, each run of equal power adds its power times the
+    // profile sum under it, read from window_prefix, so a shift costs O(runs) instead of O(duration).
+    double overlap(size_t i, int shift, bool by_runs) const {
+        double sum = 0.0;
+        if (by_runs) {
+            const double* prefix = window_prefix.data() + shift;
+            for (size_t r = run_offsets[i]; r < run_offsets[i + 1]; r++) {
+                int end = r + 1 < run_offsets[i + 1] ? run_start[r + 1] : static_cast<int>(mid[i].size());
+                sum += run_power[r] * (prefix[end] - prefix[run_start[r]]);
+            }
+        } else {
+            const double* window = profile.data() + offset[i] + shift;
+            for (size_t j = 0; j < mid[i].size(); j++) sum += mid[i][j] * window[j];
+        }
+        return sum;
+    }
+
+    // Shift in [0, max_shift] with the least overlap, preferring `preferred` and then smaller shifts on ties
+    int bestShift(size_t i, int max_shift, int preferred) const {
+        bool by_runs = scoreByRuns(i);
+        if (by_runs) { // Prefix sums of the profile over every slot the member can cover, once for all its shifts
+            int span = max(max_shift, preferred) + static_cast<int>(mid[i].size());
+            window_prefix.resize(span + 1);
+            window_prefix[0] = 0.0;
+            for (int k = 0; k < span; k++) window_prefix[k + 1] = window_prefix[k] + profile[offset[i] + k];
+        }
+
+        int best = preferred;
+        double best_overlap = overlap(i, preferred, by_runs);
+        for (int shift = 0; shift <= max_shift; shift++) {
+            double candidate = overlap(i, shift, by_runs);
+            if (candidate < best_overlap - 1e-9 * (1.0 + fabs(best_overlap))) {
+                best = shift;
+                best_overlap = candidate;
+            }
+        }
+        return best;
+    }
+
+    AlignedAggregate build(const vector<Flexoffer>& flex_offers, const vector<int>& shifts) const {
+        size_t n = flex_offers.size();
+        int first_slot = numeric_limits<int>::max(), remaining_flexibility = numeric_limits<int>::max();
+        for (size_t i = 0; i < n; i++) {
+            first_slot = min(first_slot, offset[i] + shifts[i]);
+            remaining_flexibility = min(remaining_flexibility, flexibility[i] - shifts[i]);
+        }
+
+        int common_length = 0;
+        for (size_t i = 0; i < n; i++) {
+            int length = max(flex_offers[i].get_duration(), static_cast<int>(flex_offers[i].get_profile_ref().size()));
+            common_length = max(common_length, offset[i] + shifts[i] - first_slot + length);
+        }
+        vector<TimeSlice> aggregated_profile(common_length, TimeSlice(0.0, 0.0));
+        for (size_t i = 0; i < n; i++) {
+            const auto& profile = flex_offers[i].get_profile_ref();
+            TimeSlice* target = aggregated_profile.data() + offset[i] + shifts[i] - first_slot;
+            for (size_t j = 0; j < profile.size(); j++) {
+                target[j].min_power += profile[j].min_power;
+                target[j].max_power += profile[j].max_power;
+            }
+        }
+
+        time_t aggregated_earliest = earliest + static_cast<time_t>(first_slot) * resolution;
+        time_t aggregated_latest = aggregated_earliest + static_cast<time_t>(remaining_flexibility) * resolution;
+        return AlignedAggregate{
+            Flexoffer(-1, aggregated_earliest, aggregated_latest, aggregated_latest, aggregated_profile, common_length, 0.0, 0.0),
+            shifts};
+    }
+};
+
+AlignedAggregate balance_alignment_aggregate(const vector<Flexoffer>& flex_offers, int resolution) {
+    INSTRUMENT_SCOPE("balance_alignment_aggregate");
+    AlignmentTimeline timeline(flex_offers, resolution);
+    size_t n = flex_offers.size();
+
+    // Largest members first, so the small ones fill the gaps they leave
+    vector<double> weight(n, 0.0);
+    for (size_t i = 0; i < n; i++) {
+        for (double power : timeline.mid[i]) weight[i] += fabs(power);
+    }
+    vector<size_t> order(n);
+    iota(order.begin(), order.end(), 0);
+    stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return weight[a] > weight[b]; });
+
+    vector<int> shifts(n, 0);
+    for (size_t i : order) {
+        shifts[i] = timeline.bestShift(i, timeline.flexibility[i], 0);
+        timeline.place(i, shifts[i], 1.0);
+    }
+    INSTRUMENT_COUNT("balance_alignment_aggregate", "candidates",
+                     accumulate(timeline.flexibility.begin(), timeline.flexibility.end(), 0LL) + static_cast<long long>(n));
+    return timeline.build(flex_offers, shifts);
+}
+
+AlignedAggregate best_shift_aggregate(const vector<Flexoffer>& flex_offers, int max_flexibility_loss, int max_passes,
+                                      int resolution) {
+    INSTRUMENT_SCOPE("best_shift_aggregate");
+    if (max_flexibility_loss < 0) throw invalid_argument("max_flexibility_loss must not be negative.");
+    AlignmentTimeline timeline(flex_offers, resolution);
+    size_t n = flex_offers.size();
+
+    // The aggregate keeps at least this much time flexibility
+    int kept_flexibility = max(0, timeline.start_alignment_flexibility - max_flexibility_loss);
+
+    vector<int> shifts(n, 0);
+    for (size_t i = 0; i < n; i++) timeline.place(i, 0, 1.0);
+
+    for (int pass = 0; pass < max_passes; pass++) {
+        bool changed = false;
+        for (size_t i = 0; i < n; i++) {
+            int max_shift = timeline.flexibility[i] - kept_flexibility;
+            if (max_shift <= 0 && shifts[i] == 0) continue;
+
+            timeline.place(i, shifts[i], -1.0);
+            int shift = timeline.bestShift(i, max(max_shift, 0), shifts[i]);
+            timeline.place(i, shift, 1.0);
+            if (shift != shifts[i]) {
+                shifts[i] = shift;
+                changed = true;
+            }
+        }
+        INSTRUMENT_COUNT("best_shift_aggregate", "passes", 1);
+        if (!changed) break;
+    }
+    return timeline.build(flex_offers, shifts);
+}
+
+/** 🔹 Shifted members see the aggregate's schedule like start aligned ones, from their shifted start on.
+ *  Each slot's allocation is split in proportion to the members' [min_power, max_power] headroom. */
+void disaggregate_aligned(const Flexoffer& aggregate, const vector<int>& shifts, vector<Flexoffer>& members, int resolution) {
+    if (members.empty()) return;
+    if (shifts.size() != members.size()) throw invalid_argument("Need exactly one shift per member.");
+
+    resolution = resolve_time_resolution(resolution);
+    time_t earliest = members[0].get_est() + static_cast<time_t>(shifts[0]) * resolution;
+    for (size_t i = 0; i < members.size(); i++) {
+        earliest = min(earliest, members[i].get_est() + static_cast<time_t>(shifts[i]) * resolution);
+    }
+
+    vector<int> offsets(members.size());
+    int common_length = 0;
+    for (size_t i = 0; i < members.size(); i++) {
+        offsets[i] = static_cast<int>((members[i].get_est() + static_cast<time_t>(shifts[i]) * resolution - earliest) / resolution);
+        common_length = max(common_length, offsets[i] + members[i].get_duration());
+    }
+
+    // Total headroom per slot of the aggregate, over the slices within each member's duration
+    vector<double> total_min(common_length, 0.0), total_max(common_length, 0.0);
+    for (size_t i = 0; i < members.size(); i++) {
+        const auto& profile = members[i].get_profile_ref();
+        size_t length = min(profile.size(), static_cast<size_t>(max(members[i].get_duration(), 0)));
+        for (size_t j = 0; j < length; j++) {
+            total_min[offsets[i] + j] += profile[j].min_power;
+            total_max[offsets[i] + j] += profile[j].max_power;
+        }
+    }
+
+    // Share of each slot's headroom the aggregate schedule uses, clamped to the feasible range
+    const auto& allocation = aggregate.get_scheduled_allocation_ref();
+    vector<double> fraction(common_length, 0.0);
+    for (int t = 0; t < common_length; t++) {
+        double headroom = total_max[t] - total_min[t];
+        double allocated = t < static_cast<int>(allocation.size()) ? allocation[t] : 0.0;
+        if (headroom > 0.0) fraction[t] = min(max((allocated - total_min[t]) / headroom, 0.0), 1.0);
+    }
+
+    time_t shift = aggregate.get_scheduled_start_time() - aggregate.get_est();
+    for (size_t i = 0; i < members.size(); i++) {
+        Flexoffer& member = members[i];
+        const auto& profile = member.get_profile_ref();
+        vector<double>& member_allocation = member.get_scheduled_allocation_ref();
+        member_allocation.assign(max(member.get_duration(), 0), 0.0);
+
+        const double* f = fraction.data() + offsets[i];
+        size_t length = min(profile.size(), member_allocation.size());
+        for (size_t j = 0; j < length; j++) {
+            member_allocation[j] = profile[j].min_power + f[j] * (profile[j].max_power - profile[j].min_power);
+        }
+        member.set_scheduled_start_time(member.get_est() + static_cast<time_t>(shifts[i]) * resolution + shift);
+    }
+}
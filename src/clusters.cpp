@@ -1,85 +1,421 @@
 #include "../include/groups.h"
 #include "../include/clusters.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+#include "../include/spatial_index.h"
 
-#include <pybind11/pybind11.h>
 #include <cmath>
+#include <algorithm>
+#include <functional>
 #include <limits>
+#include <map>
+#include <queue>
+#include <set>
+#include <tuple>
 
-struct MBR {
-    int min_est_hour;
-    int max_est_hour;
-    int min_lst_hour;
-    int max_lst_hour;
+static double centroidDistance(double est1, double lst1, double est2, double lst2);
+static MBR unionMBR(const MBR&, const MBR&);
+
+namespace {
+
+// Candidate merge, ordered like the original full scan: by distance, then by position of both groups
+struct PairKey {
+    double dist;
+    int first;
+    int second;
+
+    bool operator<(const PairKey& other) const {
+        return tie(dist, first, second) < tie(other.dist, other.first, other.second);
+    }
 };
 
-static double groupDistance(const Fo_Group&, const Fo_Group&);
-void createMBR(const Fo_Group&, MBR&);
-static Fo_Group mergeGroups(const Fo_Group&, const Fo_Group&, int);
-bool exceedsThreshold(const MBR&, int, int);
+struct ClusterNode {
+    MBR mbr;
+    int size;
+    int site;
+    int merge_index;
+    int first_unit; // Units of the node form a linked list through next_unit
+    int last_unit;
+    bool alive;
+};
 
-void clusterFo_Group(vector<Fo_Group>& groups, int est_threshold, int lst_threshold, int max_group_size) {
-    if (groups.size() <= 1) return;
+// All live nodes sharing one MBR. Distances only depend on centroids,
+// so the best merge touching a site always involves its lowest nodes.
+struct Site {
+    MBR mbr;
+    double est;
+    double lst;
+    set<int> nodes;  // Node ids are creation order, which is the position in the original group vector
+    int nearest;     // Nearest other site by (distance, lowest node ids), -1 if none
+    PairKey nearest_key;
+    int version;
+};
 
-    bool merged = true;
-    int nextGroupId = 1000;
+struct HeapEntry {
+    PairKey key;
+    int site;
+    int version;
+
+    bool operator>(const HeapEntry& other) const { return other.key < key; }
+};
 
+class ClusterEngine {
+private:
+    vector<ClusterNode> nodes;
+    vector<int> next_unit;
+    vector<Site> sites;
+    map<tuple<int, int, int, int>, int> site_index;
+    priority_queue<HeapEntry, vector<HeapEntry>, greater<HeapEntry>> heap;
+    int merges = 0;
+    int est_threshold;
+    int lst_threshold;
+    bool mergeable_only; // Only pairs within the thresholds are candidates, found through the grid of live sites
+    MBRGrid grid;
 
-    while (merged && groups.size() > 1) {
-        merged = false;
-        double minDist = numeric_limits<double>::max();
-        int bestA = -1, bestB = -1;
+    int siteFor(const MBR& mbr) {
+        auto key = make_tuple(mbr.min_est_hour, mbr.max_est_hour, mbr.min_lst_hour, mbr.max_lst_hour);
+        auto it = site_index.find(key);
+        if (it != site_index.end()) return it->second;
 
-        // Find the two closest groups
-        for (size_t i = 0; i < groups.size(); ++i) {
-            for (size_t j = i + 1; j < groups.size(); ++j) {
-                double dist = groupDistance(groups[i], groups[j]);
-                if (dist < minDist) {
-                    minDist = dist;
-                    bestA = (int)i;
-                    bestB = (int)j;
-                }
+        Site site;
+        site.mbr = mbr;
+        site.est = (mbr.min_est_hour + mbr.max_est_hour) / 2.0;
+        site.lst = (mbr.min_lst_hour + mbr.max_lst_hour) / 2.0;
+        site.nearest = -1;
+        site.nearest_key = PairKey{0.0, 0, 0};
+        site.version = 0;
+        sites.push_back(site);
+        site_index[key] = static_cast<int>(sites.size()) - 1;
+        return static_cast<int>(sites.size()) - 1;
+    }
+
+    bool live(int s) const { return !sites[s].nodes.empty(); }
+    int lowest(int s) const { return live(s) ? *sites[s].nodes.begin() : -1; }
+
+    PairKey interKey(int s, int t) const {
+        int a = lowest(s), b = lowest(t);
+        double dist = centroidDistance(sites[s].est, sites[s].lst, sites[t].est, sites[t].lst);
+        return PairKey{dist, min(a, b), max(a, b)};
+    }
+
+    void syncGrid(int s) {
+        if (!mergeable_only) return;
+        if (live(s) && !grid.contains(s)) grid.insert(s, sites[s].mbr);
+        if (!live(s) && grid.contains(s)) grid.remove(s);
+    }
+
+    bool pairable(int s, int t) const {
+        return !mergeable_only || !exceedsThreshold(unionMBR(sites[s].mbr, sites[t].mbr), est_threshold, lst_threshold);
+    }
+
+    // Live sites that can pair with site s, in increasing order
+    vector<int> candidates(int s) const {
+        vector<int> result;
+        if (mergeable_only) {
+            result = grid.mergeCandidates(sites[s].mbr);
+            sort(result.begin(), result.end());
+        } else {
+            for (int t = 0; t < static_cast<int>(sites.size()); t++) {
+                if (live(t)) result.push_back(t);
+            }
+        }
+        return result;
+    }
+
+    void recomputeNearest(int s) {
+        sites[s].nearest = -1;
+        for (int t : candidates(s)) {
+            if (t == s) continue;
+            PairKey key = interKey(s, t);
+            if (sites[s].nearest == -1 || key < sites[s].nearest_key) {
+                sites[s].nearest = t;
+                sites[s].nearest_key = key;
             }
         }
+    }
 
-        if (bestA == -1 || bestB == -1) {
-            break;
+    // Queues the best merge involving site s, invalidating older entries of the site
+    void push(int s) {
+        Site& site = sites[s];
+        site.version++;
+        if (!live(s)) return;
+
+        bool has_candidate = false;
+        PairKey best{0.0, 0, 0};
+        bool mergeable = !mergeable_only || !exceedsThreshold(site.mbr, est_threshold, lst_threshold);
+        if (site.nodes.size() >= 2 && mergeable) { // Two nodes with the same MBR are at distance 0
+            auto it = site.nodes.begin();
+            int first = *it++;
+            best = PairKey{0.0, first, *it};
+            has_candidate = true;
+        }
+        if (site.nearest != -1 && (!has_candidate || site.nearest_key < best)) {
+            best = site.nearest_key;
+            has_candidate = true;
         }
+        if (has_candidate) heap.push(HeapEntry{best, s, site.version});
+    }
+
+    void merge(int a, int b, const MBR& mbr) {
+        int c = static_cast<int>(nodes.size());
+        ClusterNode node;
+        node.mbr = mbr;
+        node.size = nodes[a].size + nodes[b].size;
+        node.merge_index = merges++;
+        node.first_unit = nodes[a].first_unit;
+        node.last_unit = nodes[b].last_unit;
+        node.alive = true;
+        next_unit[nodes[a].last_unit] = nodes[b].first_unit;
+        nodes[a].alive = false;
+        nodes[b].alive = false;
+        node.site = siteFor(mbr);
+        nodes.push_back(node);
 
-        Fo_Group candidate = mergeGroups(groups[bestA], groups[bestB], nextGroupId++);
-        MBR candidateMBR;
-        createMBR(candidate, candidateMBR);
+        int touched[3] = {nodes[a].site, nodes[b].site, node.site};
+        int lowest_before[3];
+        for (int k = 0; k < 3; k++) lowest_before[k] = lowest(touched[k]);
 
-        bool thresholdOK = !exceedsThreshold(candidateMBR, est_threshold, lst_threshold);
-        bool sizeOK = (int)candidate.getFlexOffers().size() <= max_group_size;
+        sites[nodes[a].site].nodes.erase(a);
+        sites[nodes[b].site].nodes.erase(b);
+        sites[node.site].nodes.insert(c);
+        for (int k = 0; k < 3; k++) syncGrid(touched[k]);
 
-        if (thresholdOK && sizeOK) {
-            if (bestA > bestB) swap(bestA, bestB);
-            groups.erase(groups.begin() + bestB);
-            groups.erase(groups.begin() + bestA);
-            groups.push_back(candidate);
-            merged = true;
+        // Sites whose lowest node changed affect the pair keys of every other site
+        vector<int> changed;
+        for (int k = 0; k < 3; k++) {
+            int s = touched[k];
+            if (lowest(s) != lowest_before[k] && find(changed.begin(), changed.end(), s) == changed.end()) {
+                changed.push_back(s);
+            }
+        }
+
+        for (int s : changed) {
+            if (live(s)) recomputeNearest(s);
+        }
+
+        // Only sites that can pair with a changed site see their nearest site change
+        vector<int> affected;
+        if (mergeable_only) {
+            for (int s : changed) {
+                vector<int> near = candidates(s);
+                affected.insert(affected.end(), near.begin(), near.end());
+            }
+            sort(affected.begin(), affected.end());
+            affected.erase(unique(affected.begin(), affected.end()), affected.end());
         } else {
-            merged = false;
+            for (int t = 0; t < static_cast<int>(sites.size()); t++) affected.push_back(t);
+        }
+
+        for (int t : affected) {
+            if (!live(t) || find(changed.begin(), changed.end(), t) != changed.end()) continue;
+
+            Site& site = sites[t];
+            if (site.nearest != -1 && find(changed.begin(), changed.end(), site.nearest) != changed.end()) {
+                recomputeNearest(t);
+                push(t);
+                continue;
+            }
+
+            bool improved = false;
+            for (int s : changed) {
+                if (!live(s) || !pairable(t, s)) continue;
+                PairKey key = interKey(t, s);
+                if (site.nearest == -1 || key < site.nearest_key) {
+                    site.nearest = s;
+                    site.nearest_key = key;
+                    improved = true;
+                }
+            }
+            if (improved) push(t);
+        }
+
+        for (int k = 0; k < 3; k++) push(touched[k]);
+    }
+
+public:
+    ClusterEngine(const vector<MBR>& mbrs, const vector<int>& sizes, int est_threshold, int lst_threshold, bool mergeable_only)
+        : est_threshold(est_threshold), lst_threshold(lst_threshold), mergeable_only(mergeable_only),
+          grid(est_threshold, lst_threshold) {
+        nodes.reserve(2 * mbrs.size());
+        next_unit.assign(mbrs.size(), -1);
+
+        for (size_t u = 0; u < mbrs.size(); u++) {
+            ClusterNode node;
+            node.mbr = mbrs[u];
+            node.size = sizes[u];
+            node.site = siteFor(mbrs[u]);
+            node.merge_index = -1;
+            node.first_unit = static_cast<int>(u);
+            node.last_unit = static_cast<int>(u);
+            node.alive = true;
+            nodes.push_back(node);
+            sites[node.site].nodes.insert(static_cast<int>(u));
+        }
+
+        for (int s = 0; s < static_cast<int>(sites.size()); s++) syncGrid(s);
+        for (int s = 0; s < static_cast<int>(sites.size()); s++) {
+            recomputeNearest(s);
+            push(s);
         }
     }
+
+    void run(int max_group_size) {
+        while (!heap.empty()) {
+            HeapEntry entry = heap.top();
+            heap.pop();
+            if (!live(entry.site) || entry.version != sites[entry.site].version) continue; // Stale entry
+
+            // Merge the two closest groups, or stop at the first merge that breaks the limits
+            int a = entry.key.first, b = entry.key.second;
+            MBR candidate = unionMBR(nodes[a].mbr, nodes[b].mbr);
+            bool thresholdOK = !exceedsThreshold(candidate, est_threshold, lst_threshold);
+            bool sizeOK = nodes[a].size + nodes[b].size <= max_group_size;
+            if (!thresholdOK || !sizeOK) break;
+
+            merge(a, b, candidate);
+        }
+    }
+
+    ClusterResult result() const {
+        ClusterResult result;
+        for (const ClusterNode& node : nodes) {
+            if (!node.alive) continue;
+            vector<int> units;
+            for (int u = node.first_unit; u != -1; u = next_unit[u]) units.push_back(u);
+            result.clusters.push_back(move(units));
+            result.merge_index.push_back(node.merge_index);
+        }
+        return result;
+    }
+};
+
+} // namespace
+
+/** Agglomerative clustering over cached MBRs: repeatedly merges the two closest units (by MBR centroid),
+ *  stopping at the first closest pair whose merge would exceed the thresholds or max_group_size. */
+ClusterResult clusterMBRs(const vector<MBR>& mbrs, const vector<int>& sizes, int est_threshold, int lst_threshold, int max_group_size) {
+    INSTRUMENT_SCOPE("clusterMBRs");
+    ClusterEngine engine(mbrs, sizes, est_threshold, lst_threshold, false);
+    if (mbrs.size() > 1) engine.run(max_group_size);
+    return engine.result();
+}
+
+/** 🔹 Helper function: clusters one partition like clusterMBRs, but only ever considers pairs whose merge stays
+ *  within the thresholds, so nearest neighbours come from the neighbouring grid cells instead of all groups.
+ *  Stops at the first closest such pair whose merge would exceed max_group_size. */
+static ClusterResult clusterMergeableMBRs(const vector<MBR>& mbrs, const vector<int>& sizes, int est_threshold,
+                                          int lst_threshold, int max_group_size) {
+    INSTRUMENT_SCOPE("clusterMBRs");
+    ClusterEngine engine(mbrs, sizes, est_threshold, lst_threshold, true);
+    if (mbrs.size() > 1) engine.run(max_group_size);
+    return engine.result();
+}
+
+static void groupMBRs(const vector<Fo_Group>& groups, vector<MBR>& mbrs, vector<int>& sizes) {
+    mbrs.assign(groups.size(), MBR{0, 0, 0, 0});
+    sizes.assign(groups.size(), 0);
+    for (size_t i = 0; i < groups.size(); ++i) {
+        createMBR(groups[i], mbrs[i]);
+        sizes[i] = (int)groups[i].getFlexOffers().size();
+    }
+}
+
+// Appends the groups described by a clustering of the units `unit_ids` to `out`, numbering new groups from nextGroupId
+static void collectGroups(vector<Fo_Group>& groups, const vector<int>& unit_ids, const ClusterResult& clustered,
+                          int& nextGroupId, vector<Fo_Group>& out) {
+    for (size_t k = 0; k < clustered.clusters.size(); ++k) {
+        const vector<int>& units = clustered.clusters[k];
+        if (clustered.merge_index[k] == -1) {
+            out.push_back(move(groups[unit_ids[units.front()]]));
+            continue;
+        }
+
+        Fo_Group merged(nextGroupId + clustered.merge_index[k]);
+        for (int u : units) {
+            for (const auto& fo : groups[unit_ids[u]].getFlexOffers()) {
+                merged.addFlexOffer(fo);
+            }
+        }
+        out.push_back(move(merged));
+    }
+    nextGroupId += (int)(unit_ids.size() - clustered.clusters.size()); // Every merge removes one group
+}
+
+void clusterFo_Group(vector<Fo_Group>& groups, int est_threshold, int lst_threshold, int max_group_size) {
+    INSTRUMENT_SCOPE("clusterFo_Group");
+    if (groups.size() <= 1) return;
+
+    // MBRs are computed once per group and then merged incrementally
+    vector<MBR> mbrs;
+    vector<int> sizes;
+    groupMBRs(groups, mbrs, sizes);
+
+    ClusterResult clustered = clusterMBRs(mbrs, sizes, est_threshold, lst_threshold, max_group_size);
+
+    vector<int> unit_ids(groups.size());
+    for (size_t i = 0; i < groups.size(); ++i) unit_ids[i] = (int)i;
+
+    int nextGroupId = 1000;
+    vector<Fo_Group> result;
+    result.reserve(clustered.clusters.size());
+    collectGroups(groups, unit_ids, clustered, nextGroupId, result);
+    groups = move(result);
 }
 
-static double groupDistance(const Fo_Group& g1, const Fo_Group& g2) {
-    MBR m1, m2;
-    createMBR(g1, m1);
-    createMBR(g2, m2);
+void clusterFo_Group_partitioned(vector<Fo_Group>& groups, int est_threshold, int lst_threshold, int max_group_size, int num_threads) {
+    INSTRUMENT_SCOPE("clusterFo_Group_partitioned");
+    if (groups.size() <= 1) return;
+
+    vector<MBR> mbrs;
+    vector<int> sizes;
+    groupMBRs(groups, mbrs, sizes);
 
-    double c1_est = (m1.min_est_hour + m1.max_est_hour) / 2.0;
-    double c1_lst = (m1.min_lst_hour + m1.max_lst_hour) / 2.0;
-    double c2_est = (m2.min_est_hour + m2.max_est_hour) / 2.0;
-    double c2_lst = (m2.min_lst_hour + m2.max_lst_hour) / 2.0;
+    // Groups in different partitions can never be merged, so each partition is clustered on its own
+    vector<vector<int>> partitions = partitionMBRs(mbrs, est_threshold, lst_threshold);
+    vector<ClusterResult> results(partitions.size());
 
-    double dx = c2_est - c1_est;
-    double dy = c2_lst - c1_lst;
+    parallel_for(partitions.size(), num_threads, [&](size_t p) {
+        vector<MBR> partition_mbrs;
+        vector<int> partition_sizes;
+        for (int u : partitions[p]) {
+            partition_mbrs.push_back(mbrs[u]);
+            partition_sizes.push_back(sizes[u]);
+        }
+        results[p] = clusterMergeableMBRs(partition_mbrs, partition_sizes, est_threshold, lst_threshold, max_group_size);
+    });
+
+    int nextGroupId = 1000;
+    vector<Fo_Group> result;
+    for (size_t p = 0; p < partitions.size(); ++p) {
+        collectGroups(groups, partitions[p], results[p], nextGroupId, result);
+    }
+    groups = move(result);
+}
+
+vector<vector<int>> clusterFlexofferBatch(const FlexofferBatch& batch, int est_threshold, int lst_threshold, int max_group_size) {
+    INSTRUMENT_SCOPE("clusterFlexofferBatch");
+    // Every offer starts as its own group, so its MBR is a single point
+    vector<MBR> mbrs(batch.size());
+    vector<int> sizes(batch.size(), 1);
+    for (size_t i = 0; i < batch.size(); ++i) {
+        mbrs[i] = MBR{batch.est_hour[i], batch.est_hour[i], batch.lst_hour[i], batch.lst_hour[i]};
+    }
+    return clusterMBRs(mbrs, sizes, est_threshold, lst_threshold, max_group_size).clusters;
+}
+
+static double centroidDistance(double est1, double lst1, double est2, double lst2) {
+    double dx = est2 - est1;
+    double dy = lst2 - lst1;
     return sqrt(dx*dx + dy*dy);
 }
 
+static MBR unionMBR(const MBR& m1, const MBR& m2) {
+    return MBR{min(m1.min_est_hour, m2.min_est_hour), max(m1.max_est_hour, m2.max_est_hour),
+               min(m1.min_lst_hour, m2.min_lst_hour), max(m1.max_lst_hour, m2.max_lst_hour)};
+}
+
 void createMBR(const Fo_Group& group, MBR& mbr) {
+    INSTRUMENT_SCOPE("createMBR");
     const auto& flexoffers = group.getFlexOffers();
     if (flexoffers.empty()) return;
 
@@ -99,17 +435,6 @@ void createMBR(const Fo_Group& group, MBR& mbr) {
     }
 }
 
-static Fo_Group mergeGroups(const Fo_Group& g1, const Fo_Group& g2, int newGroupId) {
-    Fo_Group merged(newGroupId);
-    for (const auto& fo : g1.getFlexOffers()) {
-        merged.addFlexOffer(fo);
-    }
-    for (const auto& fo : g2.getFlexOffers()) {
-        merged.addFlexOffer(fo);
-    }
-    return merged;
-}
-
 bool exceedsThreshold(const MBR& mbr, int est_threshold, int lst_threshold) {
     int est_range = mbr.max_est_hour - mbr.min_est_hour;
     int lst_range = mbr.max_lst_hour - mbr.min_lst_hour;
@@ -0,0 +1,140 @@
+#include "../include/flexibility.h"
+#include "../include/helpers.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <deque>
+#include <stdexcept>
+
+using namespace std;
+
+struct OfferFlexibility {
+    double time;
+    double energy;
+    double area;
+};
+
+/** 🔹 Helper: min/max power of slice j of a Flexoffer profile. */
+struct SliceProfile {
+    const TimeSlice* slices;
+    double lower(int j) const { return slices[j].min_power; }
+    double upper(int j) const { return slices[j].max_power; }
+};
+
+/** 🔹 Helper: min/max power of slice j of an offer in the columns of a FlexofferBatch. */
+struct ColumnProfile {
+    const double* min_power;
+    const double* max_power;
+    double lower(int j) const { return min_power[j]; }
+    double upper(int j) const { return max_power[j]; }
+};
+
+/** 🔹 Kernel: the three flexibilities of one offer, reading its slices through a SliceProfile or ColumnProfile.
+ *  The envelopes of all starts are sliding window extremes over the profile padded with zeros, one monotone
+ *  deque each: O(duration + flexibility). */
+template <typename Profile>
+static OfferFlexibility measure(time_t est, time_t lst, const Profile& profile, int length, int resolution) {
+    double hours = resolution / 3600.0;
+    int flexibility = max(0, static_cast<int>((lst - est) / resolution));
+    OfferFlexibility result{max(0.0, static_cast<double>(lst - est) / resolution), 0.0, 0.0};
+
+    for (int j = 0; j < length; j++) result.energy += (profile.upper(j) - profile.lower(j)) * hours;
+
+    auto lower = [&](int k) { return k >= 0 && k < length ? profile.lower(k) : 0.0; };
+    auto upper = [&](int k) { return k >= 0 && k < length ? profile.upper(k) : 0.0; };
+    deque<int> highest, lowest; // Candidate positions of the window [t - flexibility, t]
+    for (int k = -flexibility; k < length + flexibility; k++) {
+        while (!highest.empty() && upper(highest.back()) <= upper(k)) highest.pop_back();
+        highest.push_back(k);
+        while (!lowest.empty() && lower(lowest.back()) >= lower(k)) lowest.pop_back();
+        lowest.push_back(k);
+        if (k < 0) continue;
+
+        int t = k; // Slot t sees profile positions t - shift for every shift in [0, flexibility]
+        while (highest.front() < t - flexibility) highest.pop_front();
+        while (lowest.front() < t - flexibility) lowest.pop_front();
+        result.area += (upper(highest.front()) - lower(lowest.front())) * hours;
+    }
+    return result;
+}
+
+static OfferFlexibility measure(const Flexoffer& fo, int resolution) {
+    const auto& profile = fo.get_profile_ref();
+    return measure(fo.get_est(), fo.get_lst(), SliceProfile{profile.data()}, static_cast<int>(profile.size()), resolution);
+}
+
+double time_flexibility(const Flexoffer& fo, int resolution) {return measure(fo, resolve_time_resolution(resolution)).time;}
+
+double energy_flexibility(const Flexoffer& fo, int resolution) {return measure(fo, resolve_time_resolution(resolution)).energy;}
+
+double absolute_area(const Flexoffer& fo, int resolution) {return measure(fo, resolve_time_resolution(resolution)).area;}
+
+FlexibilityLoss::FlexibilityLoss(size_t num_groups)
+    : time_flex_loss(num_groups, 0.0), energy_flex_loss(num_groups, 0.0), area_loss(num_groups, 0.0) {}
+
+size_t FlexibilityLoss::size() const {return time_flex_loss.size();}
+
+/** 🔹 Helper function: writes the losses of group g from its members' summed flexibilities. */
+static void storeLoss(FlexibilityLoss& loss, size_t g, const OfferFlexibility& members, size_t num_members,
+                      const OfferFlexibility& aggregate) {
+    loss.time_flex_loss[g] = members.time - num_members * aggregate.time;
+    loss.energy_flex_loss[g] = members.energy - aggregate.energy;
+    loss.area_loss[g] = members.area - aggregate.area;
+}
+
+FlexibilityLoss flexibility_loss_groups(const vector<Fo_Group>& groups, const vector<Flexoffer>& aggregates, int num_threads,
+                                        int resolution) {
+    INSTRUMENT_SCOPE("flexibility_loss_groups");
+    if (!aggregates.empty() && aggregates.size() != groups.size()) {
+        throw invalid_argument("Need exactly one aggregate per group, or none for start alignment.");
+    }
+
+    resolution = resolve_time_resolution(resolution);
+    FlexibilityLoss loss(groups.size());
+    parallel_for(groups.size(), num_threads, [&](size_t g) {
+        const vector<Flexoffer>& members = groups[g].getFlexOffers();
+        if (members.empty()) return;
+
+        OfferFlexibility total{0.0, 0.0, 0.0};
+        for (const Flexoffer& fo : members) {
+            OfferFlexibility member = measure(fo, resolution);
+            total.time += member.time;
+            total.energy += member.energy;
+            total.area += member.area;
+        }
+        OfferFlexibility aggregate = aggregates.empty() ? measure(start_alignment_aggregate(members, resolution), resolution)
+                                                        : measure(aggregates[g], resolution);
+        storeLoss(loss, g, total, members.size(), aggregate);
+    });
+    return loss;
+}
+
+FlexibilityLoss flexibility_loss_batch(const FlexofferBatch& batch, const vector<vector<int>>& clusters, int num_threads,
+                                       int resolution) {
+    INSTRUMENT_SCOPE("flexibility_loss_batch");
+    resolution = resolve_time_resolution(resolution);
+    for (const auto& cluster : clusters) {
+        for (int i : cluster) {
+            if (i < 0 || static_cast<size_t>(i) >= batch.size()) throw out_of_range("Offer index out of range.");
+        }
+    }
+
+    FlexibilityLoss loss(clusters.size());
+    parallel_for(clusters.size(), num_threads, [&](size_t g) {
+        if (clusters[g].empty()) return;
+
+        OfferFlexibility total{0.0, 0.0, 0.0};
+        for (int i : clusters[g]) {
+            size_t begin = batch.profile_offsets[i];
+            int length = static_cast<int>(batch.profile_offsets[i + 1] - begin);
+            ColumnProfile profile{batch.min_power.data() + begin, batch.max_power.data() + begin};
+            OfferFlexibility member = measure(batch.earliest_start[i], batch.latest_start[i], profile, length, resolution);
+            total.time += member.time;
+            total.energy += member.energy;
+            total.area += member.area;
+        }
+        storeLoss(loss, g, total, clusters[g].size(), measure(start_alignment_aggregate_batch(batch, clusters[g], resolution), resolution));
+    });
+    return loss;
+}
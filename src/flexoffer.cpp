@@ -5,6 +5,46 @@
 
 using namespace std;
 
+static bool TIMEZONE_OFFSET_SET = false; // default: system time zone
+static int TIMEZONE_OFFSET = 0;
+
+void set_timezone_offset(int offset_seconds) {
+    TIMEZONE_OFFSET_SET = true;
+    TIMEZONE_OFFSET = offset_seconds;
+}
+
+void use_local_timezone() {
+    TIMEZONE_OFFSET_SET = false;
+    TIMEZONE_OFFSET = 0;
+}
+
+struct tm to_calendar_time(time_t timestamp) {
+    struct tm timeinfo = {};
+    if (TIMEZONE_OFFSET_SET) {
+        time_t shifted = timestamp + TIMEZONE_OFFSET;
+#ifdef _WIN32
+        gmtime_s(&timeinfo, &shifted);
+#else
+        gmtime_r(&shifted, &timeinfo);
+#endif
+    } else {
+#ifdef _WIN32
+        localtime_s(&timeinfo, &timestamp);
+#else
+        localtime_r(&timestamp, &timeinfo);
+#endif
+    }
+    return timeinfo;
+}
+
+int hour_of(time_t timestamp) {
+    if (TIMEZONE_OFFSET_SET) { // Plain arithmetic, no calendar conversion needed
+        long long seconds_of_day = ((static_cast<long long>(timestamp) + TIMEZONE_OFFSET) % 86400 + 86400) % 86400;
+        return static_cast<int>(seconds_of_day / 3600);
+    }
+    return to_calendar_time(timestamp).tm_hour;
+}
+
 TimeSlice::TimeSlice(double min, double max){
     min_power = min;
     max_power = max;
@@ -22,6 +62,9 @@ Flexoffer::Flexoffer(int oi, time_t est, time_t lst, time_t et,
     scheduled_start_time = est;
     min_overall_alloc = min;
     max_overall_alloc = max;
+    est_hour = hour_of(est);
+    lst_hour = hour_of(lst);
+    et_hour = hour_of(et);
 };
 
 //Destructor
@@ -38,17 +81,25 @@ vector<double> Flexoffer::get_scheduled_allocation() const {return scheduled_all
 time_t Flexoffer::get_scheduled_start_time() const {return scheduled_start_time;};
 double Flexoffer::get_min_overall_alloc() const {return min_overall_alloc;};
 double Flexoffer::get_max_overall_alloc() const {return max_overall_alloc;};
+const vector<TimeSlice>& Flexoffer::get_profile_ref() const {return profile;};
+vector<TimeSlice>& Flexoffer::get_profile_ref() {return profile;};
+const vector<double>& Flexoffer::get_scheduled_allocation_ref() const {return scheduled_allocation;};
+vector<double>& Flexoffer::get_scheduled_allocation_ref() {return scheduled_allocation;};
 
 //Setters
 void Flexoffer::set_scheduled_allocation(vector<double> new_sa) {scheduled_allocation = new_sa;};
 void Flexoffer::set_scheduled_start_time(time_t new_st) {scheduled_start_time = new_st;};
+void Flexoffer::assign_scheduled_allocation(const double* values, size_t size) {
+    // assign() keeps the existing buffer when it is large enough, so views of it stay valid for equal sizes
+    scheduled_allocation.assign(values, values + size);
+};
 
 void Flexoffer::print_flexoffer() {
     // Helper lambda to convert time_t to readable format
     auto to_readable = [](time_t timestamp) -> string {
         char buffer[20];
-        struct tm* timeinfo = localtime(&timestamp);
-        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", timeinfo);
+        struct tm timeinfo = to_calendar_time(timestamp);
+        strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M:%S", &timeinfo);
         return string(buffer);
     };
 
@@ -76,20 +127,11 @@ void Flexoffer::print_flexoffer() {
 }
 
 // Additional methods
-int Flexoffer::get_est_hour() const {
-    struct tm* timeinfo = localtime(&earliest_start_time);
-    return timeinfo->tm_hour;
-}
+int Flexoffer::get_est_hour() const {return est_hour;}
 
-int Flexoffer::get_lst_hour() const {
-    struct tm* timeinfo = localtime(&latest_start_time);
-    return timeinfo->tm_hour;
-}
+int Flexoffer::get_lst_hour() const {return lst_hour;}
 
-int Flexoffer::get_et_hour() const {
-    struct tm* timeinfo = localtime(&end_time);
-    return timeinfo->tm_hour;
-}
+int Flexoffer::get_et_hour() const {return et_hour;}
 
 double Flexoffer::get_total_energy() const {
     double total_energy = 0.0;
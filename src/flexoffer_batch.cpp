@@ -0,0 +1,151 @@
+#include "../include/flexoffer_batch.h"
+
+#include <stdexcept>
+
+using namespace std;
+
+FlexofferBatch::FlexofferBatch() : profile_offsets(1, 0) {}
+
+FlexofferBatch::FlexofferBatch(vector<int> offer_ids, vector<time_t> earliest_start, vector<time_t> latest_start,
+                               vector<time_t> end_time, vector<int> duration, vector<size_t> profile_offsets,
+                               vector<double> min_power, vector<double> max_power,
+                               vector<double> min_overall_alloc, vector<double> max_overall_alloc)
+    : offer_ids(move(offer_ids)), earliest_start(move(earliest_start)), latest_start(move(latest_start)),
+      end_time(move(end_time)), duration(move(duration)), min_overall_alloc(move(min_overall_alloc)),
+      max_overall_alloc(move(max_overall_alloc)), profile_offsets(move(profile_offsets)),
+      min_power(move(min_power)), max_power(move(max_power)) {
+
+    size_t n = this->offer_ids.size();
+    if (this->earliest_start.size() != n || this->latest_start.size() != n ||
+        this->end_time.size() != n || this->duration.size() != n) {
+        throw invalid_argument("All FlexofferBatch columns must have one entry per offer.");
+    }
+    if (this->min_overall_alloc.empty()) this->min_overall_alloc.assign(n, 0.0);
+    if (this->max_overall_alloc.empty()) this->max_overall_alloc.assign(n, 0.0);
+    if (this->min_overall_alloc.size() != n || this->max_overall_alloc.size() != n) {
+        throw invalid_argument("min/max overall allocation must have one entry per offer.");
+    }
+    if (this->profile_offsets.size() != n + 1 || this->profile_offsets.front() != 0 ||
+        this->profile_offsets.back() != this->min_power.size() || this->min_power.size() != this->max_power.size()) {
+        throw invalid_argument("profile_offsets must have one entry per offer plus one, starting at 0 and ending at the profile length.");
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (this->profile_offsets[i + 1] < this->profile_offsets[i]) {
+            throw invalid_argument("profile_offsets must be non-decreasing.");
+        }
+        if (this->duration[i] < 0 ||
+            this->profile_offsets[i + 1] - this->profile_offsets[i] != static_cast<size_t>(this->duration[i])) {
+            throw invalid_argument("The profile of every offer must have exactly duration slices.");
+        }
+    }
+
+    est_hour.resize(n);
+    lst_hour.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        est_hour[i] = hour_of(this->earliest_start[i]);
+        lst_hour[i] = hour_of(this->latest_start[i]);
+    }
+}
+
+FlexofferBatch FlexofferBatch::from_flexoffers(const vector<Flexoffer>& flex_offers) {
+    size_t num_slices = 0;
+    for (const auto& fo : flex_offers) num_slices += fo.get_profile_ref().size();
+
+    FlexofferBatch batch;
+    batch.reserve(flex_offers.size(), num_slices);
+    for (const auto& fo : flex_offers) batch.add(fo);
+    return batch;
+}
+
+size_t FlexofferBatch::size() const {return offer_ids.size();}
+
+void FlexofferBatch::reserve(size_t num_offers, size_t num_slices) {
+    offer_ids.reserve(num_offers);
+    earliest_start.reserve(num_offers);
+    latest_start.reserve(num_offers);
+    end_time.reserve(num_offers);
+    duration.reserve(num_offers);
+    min_overall_alloc.reserve(num_offers);
+    max_overall_alloc.reserve(num_offers);
+    profile_offsets.reserve(num_offers + 1);
+    est_hour.reserve(num_offers);
+    lst_hour.reserve(num_offers);
+    min_power.reserve(num_slices);
+    max_power.reserve(num_slices);
+}
+
+void FlexofferBatch::add(const Flexoffer& fo) {
+    if (fo.get_duration() < 0 || fo.get_profile_ref().size() != static_cast<size_t>(fo.get_duration())) {
+        throw invalid_argument("The profile of every offer must have exactly duration slices.");
+    }
+    offer_ids.push_back(fo.get_offer_id());
+    earliest_start.push_back(fo.get_est());
+    latest_start.push_back(fo.get_lst());
+    end_time.push_back(fo.get_et());
+    duration.push_back(fo.get_duration());
+    min_overall_alloc.push_back(fo.get_min_overall_alloc());
+    max_overall_alloc.push_back(fo.get_max_overall_alloc());
+    est_hour.push_back(fo.get_est_hour());
+    lst_hour.push_back(fo.get_lst_hour());
+    for (const auto& ts : fo.get_profile_ref()) {
+        min_power.push_back(ts.min_power);
+        max_power.push_back(ts.max_power);
+    }
+    profile_offsets.push_back(min_power.size());
+}
+
+void FlexofferBatch::append(const FlexofferBatch& other) {
+    size_t base = min_power.size();
+    offer_ids.insert(offer_ids.end(), other.offer_ids.begin(), other.offer_ids.end());
+    earliest_start.insert(earliest_start.end(), other.earliest_start.begin(), other.earliest_start.end());
+    latest_start.insert(latest_start.end(), other.latest_start.begin(), other.latest_start.end());
+    end_time.insert(end_time.end(), other.end_time.begin(), other.end_time.end());
+    duration.insert(duration.end(), other.duration.begin(), other.duration.end());
+    min_overall_alloc.insert(min_overall_alloc.end(), other.min_overall_alloc.begin(), other.min_overall_alloc.end());
+    max_overall_alloc.insert(max_overall_alloc.end(), other.max_overall_alloc.begin(), other.max_overall_alloc.end());
+    est_hour.insert(est_hour.end(), other.est_hour.begin(), other.est_hour.end());
+    lst_hour.insert(lst_hour.end(), other.lst_hour.begin(), other.lst_hour.end());
+    for (size_t i = 1; i < other.profile_offsets.size(); i++) profile_offsets.push_back(base + other.profile_offsets[i]);
+    min_power.insert(min_power.end(), other.min_power.begin(), other.min_power.end());
+    max_power.insert(max_power.end(), other.max_power.begin(), other.max_power.end());
+}
+
+Flexoffer FlexofferBatch::to_flexoffer(size_t index) const {
+    vector<TimeSlice> profile = get_profile(index);
+    return Flexoffer(offer_ids[index], earliest_start[index], latest_start[index], end_time[index],
+                     profile, duration[index], min_overall_alloc[index], max_overall_alloc[index]);
+}
+
+vector<Flexoffer> FlexofferBatch::to_flexoffers() const {
+    vector<Flexoffer> flex_offers;
+    flex_offers.reserve(size());
+    for (size_t i = 0; i < size(); i++) flex_offers.push_back(to_flexoffer(i));
+    return flex_offers;
+}
+
+int FlexofferBatch::get_offer_id(size_t index) const {return offer_ids.at(index);}
+time_t FlexofferBatch::get_est(size_t index) const {return earliest_start.at(index);}
+time_t FlexofferBatch::get_lst(size_t index) const {return latest_start.at(index);}
+time_t FlexofferBatch::get_et(size_t index) const {return end_time.at(index);}
+int FlexofferBatch::get_duration(size_t index) const {return duration.at(index);}
+int FlexofferBatch::get_est_hour(size_t index) const {return est_hour.at(index);}
+int FlexofferBatch::get_lst_hour(size_t index) const {return lst_hour.at(index);}
+
+vector<TimeSlice> FlexofferBatch::get_profile(size_t index) const {
+    if (index >= size()) throw out_of_range("Offer index out of range.");
+    vector<TimeSlice> profile;
+    profile.reserve(profile_offsets[index + 1] - profile_offsets[index]);
+    for (size_t k = profile_offsets[index]; k < profile_offsets[index + 1]; k++) {
+        profile.emplace_back(min_power[k], max_power[k]);
+    }
+    return profile;
+}
+
+double FlexofferBatch::get_total_energy(size_t index) const {
+    if (index >= size()) throw out_of_range("Offer index out of range.");
+    double total_energy = 0.0;
+    for (size_t k = profile_offsets[index]; k < profile_offsets[index + 1]; k++) {
+        total_energy += (min_power[k] + max_power[k]) / 2.0; // Assuming each slice represents 1 hour, as in Flexoffer
+    }
+    return total_energy;
+}
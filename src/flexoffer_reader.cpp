@@ -0,0 +1,414 @@
+#include "../include/flexoffer_reader.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+enum Field {
+    OFFER_ID, EARLIEST_START, LATEST_START, END_TIME, DURATION,
+    MIN_POWER, MAX_POWER, MIN_OVERALL_ALLOC, MAX_OVERALL_ALLOC, NUM_FIELDS
+};
+
+static const char* const FIELD_NAMES[NUM_FIELDS] = {
+    "offer_id", "earliest_start", "latest_start", "end_time", "duration",
+    "min_power", "max_power", "min_overall_alloc", "max_overall_alloc"
+};
+
+static const Field REQUIRED_FIELDS[] = {OFFER_ID, EARLIEST_START, LATEST_START, END_TIME, MIN_POWER, MAX_POWER};
+
+// Lines per thread below which splitting a chunk further is not worth it
+static const size_t MIN_LINES_PER_TASK = 1024;
+
+static int fieldIndex(const char* begin, const char* end) {
+    size_t length = end - begin;
+    for (int f = 0; f < NUM_FIELDS; f++) {
+        if (strlen(FIELD_NAMES[f]) == length && strncmp(FIELD_NAMES[f], begin, length) == 0) return f;
+    }
+    return -1;
+}
+
+static bool isSpace(char c) {return c == ' ' || c == '\t' || c == '\r' || c == '\n';}
+
+static void trim(const char*& begin, const char*& end) {
+    while (begin < end && isSpace(*begin)) begin++;
+    while (end > begin && isSpace(*(end - 1))) end--;
+}
+
+/** 🔹 Helper function: parses [begin, end) as a whole integer, also accepting integral decimals like 3600.0 */
+static long long parseInteger(const char* begin, const char* end, Field field) {
+    trim(begin, end);
+    if (begin == end) throw invalid_argument(string("empty ") + FIELD_NAMES[field]);
+    char* stop;
+    long long value = strtoll(begin, &stop, 10);
+    if (stop == end) return value;
+    double real = strtod(begin, &stop);
+    if (stop == end && real == floor(real) && fabs(real) < 9.0e18) return static_cast<long long>(real);
+    throw invalid_argument(string("invalid integer for ") + FIELD_NAMES[field]);
+}
+
+static double parseReal(const char* begin, const char* end, Field field) {
+    trim(begin, end);
+    char* stop;
+    double value = begin == end ? NAN : strtod(begin, &stop);
+    if (begin == end || stop != end || !isfinite(value)) {
+        throw invalid_argument(string("invalid number for ") + FIELD_NAMES[field]);
+    }
+    return value;
+}
+
+/** 🔹 Helper function: parses a list of numbers separated by commas, semicolons or whitespace, optionally in [ ] */
+static void parseList(const char* begin, const char* end, Field field, vector<double>& values) {
+    trim(begin, end);
+    if (begin < end && *begin == '[' && *(end - 1) == ']') {
+        begin++;
+        end--;
+    }
+    values.clear();
+    const char* p = begin;
+    while (true) {
+        while (p < end && (isSpace(*p) || *p == ',' || *p == ';')) p++;
+        if (p == end) break;
+        char* stop;
+        double value = strtod(p, &stop);
+        if (stop == p || stop > end || !isfinite(value)) {
+            throw invalid_argument(string("invalid number in ") + FIELD_NAMES[field]);
+        }
+        values.push_back(value);
+        p = stop;
+    }
+}
+
+/** 🔹 The fields of one row while it is parsed; buffers are reused from row to row. */
+struct Row {
+    bool seen[NUM_FIELDS];
+    long long integers[NUM_FIELDS];
+    double reals[NUM_FIELDS];
+    vector<double> min_power;
+    vector<double> max_power;
+
+    void reset() {fill(seen, seen + NUM_FIELDS, false);}
+
+    void set(int field, const char* begin, const char* end) {
+        Field f = static_cast<Field>(field);
+        switch (f) {
+            case MIN_POWER: parseList(begin, end, f, min_power); break;
+            case MAX_POWER: parseList(begin, end, f, max_power); break;
+            case MIN_OVERALL_ALLOC:
+            case MAX_OVERALL_ALLOC: reals[f] = parseReal(begin, end, f); break;
+            default: integers[f] = parseInteger(begin, end, f); break;
+        }
+        seen[f] = true;
+    }
+};
+
+/** 🔹 Rows parsed from a range of lines, as FlexofferBatch columns. */
+struct ParsedRows {
+    vector<int> offer_ids;
+    vector<time_t> earliest_start;
+    vector<time_t> latest_start;
+    vector<time_t> end_time;
+    vector<int> duration;
+    vector<double> min_overall_alloc;
+    vector<double> max_overall_alloc;
+    vector<size_t> profile_offsets{0};
+    vector<double> min_power;
+    vector<double> max_power;
+
+    void add(const Row& row) {
+        for (Field f : REQUIRED_FIELDS) {
+            if (!row.seen[f]) throw invalid_argument(string("missing ") + FIELD_NAMES[f]);
+        }
+        if (row.integers[OFFER_ID] < numeric_limits<int>::min() || row.integers[OFFER_ID] > numeric_limits<int>::max()) {
+            throw invalid_argument("offer_id out of range");
+        }
+        if (row.min_power.size() != row.max_power.size()) {
+            throw invalid_argument("min_power and max_power must have the same length");
+        }
+        long long slices = row.seen[DURATION] ? row.integers[DURATION] : static_cast<long long>(row.min_power.size());
+        if (slices < 0 || slices > numeric_limits<int>::max()) throw invalid_argument("duration out of range");
+        if (slices != static_cast<long long>(row.min_power.size())) {
+            throw invalid_argument("duration must equal the profile length");
+        }
+        if (row.integers[LATEST_START] < row.integers[EARLIEST_START]) {
+            throw invalid_argument("latest_start is before earliest_start");
+        }
+
+        offer_ids.push_back(static_cast<int>(row.integers[OFFER_ID]));
+        earliest_start.push_back(static_cast<time_t>(row.integers[EARLIEST_START]));
+        latest_start.push_back(static_cast<time_t>(row.integers[LATEST_START]));
+        end_time.push_back(static_cast<time_t>(row.integers[END_TIME]));
+        duration.push_back(static_cast<int>(slices));
+        min_overall_alloc.push_back(row.seen[MIN_OVERALL_ALLOC] ? row.reals[MIN_OVERALL_ALLOC] : 0.0);
+        max_overall_alloc.push_back(row.seen[MAX_OVERALL_ALLOC] ? row.reals[MAX_OVERALL_ALLOC] : 0.0);
+        min_power.insert(min_power.end(), row.min_power.begin(), row.min_power.end());
+        max_power.insert(max_power.end(), row.max_power.begin(), row.max_power.end());
+        profile_offsets.push_back(min_power.size());
+    }
+
+    FlexofferBatch toBatch() {
+        return FlexofferBatch(move(offer_ids), move(earliest_start), move(latest_start), move(end_time), move(duration),
+                              move(profile_offsets), move(min_power), move(max_power),
+                              move(min_overall_alloc), move(max_overall_alloc));
+    }
+};
+
+/** 🔹 Helper function: end of the CSV field starting at p; quoted fields yield their contents */
+static const char* csvField(const char* p, const char* end, const char*& value_begin, const char*& value_end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    if (p < end && *p == '"') {
+        value_begin = ++p;
+        while (p < end && !(*p == '"' && (p + 1 == end || *(p + 1) != '"'))) p += (*p == '"') ? 2 : 1;
+        if (p >= end) throw invalid_argument("unterminated quoted field");
+        value_end = p++;
+        while (p < end && *p != ',') {
+            if (!isSpace(*p)) throw invalid_argument("unexpected text after quoted field");
+            p++;
+        }
+        return p;
+    }
+    value_begin = p;
+    while (p < end && *p != ',') p++;
+    value_end = p;
+    return p;
+}
+
+static void parseCsvLine(const string& line, const vector<int>& columns, Row& row) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    size_t column = 0;
+    while (true) {
+        const char* value_begin;
+        const char* value_end;
+        p = csvField(p, end, value_begin, value_end);
+        trim(value_begin, value_end);
+        if (column < columns.size() && columns[column] >= 0 && value_begin < value_end) { // Empty cells count as missing
+            row.set(columns[column], value_begin, value_end);
+        }
+        column++;
+        if (p == end) break;
+        p++; // Skip the comma
+    }
+    if (column != columns.size()) throw invalid_argument("expected " + to_string(columns.size()) + " columns, got " + to_string(column));
+}
+
+static const char* skipSpace(const char* p, const char* end) {
+    while (p < end && isSpace(*p)) p++;
+    return p;
+}
+
+static const char* skipJsonString(const char* p, const char* end) {
+    for (p++; p < end && *p != '"'; p++) {
+        if (*p == '\\') p++;
+    }
+    if (p >= end) throw invalid_argument("unterminated string");
+    return p + 1;
+}
+
+/** 🔹 Helper function: skips any JSON value, including nested arrays and objects */
+static const char* skipJsonValue(const char* p, const char* end) {
+    if (p < end && *p == '"') return skipJsonString(p, end);
+    if (p < end && (*p == '[' || *p == '{')) {
+        int depth = 0;
+        while (p < end) {
+            if (*p == '"') {
+                p = skipJsonString(p, end);
+                continue;
+            }
+            if (*p == '[' || *p == '{') depth++;
+            if (*p == ']' || *p == '}') depth--;
+            p++;
+            if (depth == 0) return p;
+        }
+        throw invalid_argument("unterminated array or object");
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']' && !isSpace(*p)) p++;
+    return p;
+}
+
+static void parseJsonLine(const string& line, Row& row) {
+    const char* p = line.data();
+    const char* end = p + line.size();
+    p = skipSpace(p, end);
+    if (p == end || *p != '{') throw invalid_argument("expected a JSON object");
+    p = skipSpace(p + 1, end);
+    if (p < end && *p == '}') p++;
+    else {
+        while (true) {
+            if (p == end || *p != '"') throw invalid_argument("expected a key");
+            const char* key_begin = p + 1;
+            p = skipJsonString(p, end);
+            int field = fieldIndex(key_begin, p - 1);
+            p = skipSpace(p, end);
+            if (p == end || *p != ':') throw invalid_argument("expected ':'");
+            p = skipSpace(p + 1, end);
+
+            const char* value_begin = p;
+            p = skipJsonValue(p, end);
+            bool is_null = p - value_begin == 4 && strncmp(value_begin, "null", 4) == 0;
+            if (field >= 0 && !is_null) {
+                const char* value_end = p;
+                if (*value_begin == '"') { // Numbers sent as strings
+                    value_begin++;
+                    value_end--;
+                }
+                row.set(field, value_begin, value_end);
+            }
+
+            p = skipSpace(p, end);
+            if (p < end && *p == ',') {
+                p = skipSpace(p + 1, end);
+                continue;
+            }
+            if (p < end && *p == '}') {
+                p++;
+                break;
+            }
+            throw invalid_argument("expected ',' or '}'");
+        }
+    }
+    if (skipSpace(p, end) != end) throw invalid_argument("unexpected text after the object");
+}
+
+static bool isBlank(const string& line) {
+    for (char c : line) {
+        if (!isSpace(c)) return false;
+    }
+    return true;
+}
+
+FlexofferReader::FlexofferReader(const string& path, const string& format, size_t chunk_size, int num_threads)
+    : file(path, ios::binary), chunk_size(max<size_t>(chunk_size, 1)), num_threads(num_threads), line_number(0) {
+    if (!file) throw runtime_error("Could not open " + path);
+
+    string kind = format;
+    if (kind.empty()) {
+        size_t dot = path.find_last_of('.');
+        string extension = dot == string::npos ? "" : path.substr(dot + 1);
+        kind = (extension == "jsonl" || extension == "ndjson" || extension == "json") ? "jsonl" : "csv";
+    }
+    if (kind != "csv" && kind != "jsonl") throw invalid_argument("format must be \"csv\", \"jsonl\" or \"\".");
+    jsonl = kind == "jsonl";
+    if (!jsonl) readHeader();
+}
+
+void FlexofferReader::readHeader() {
+    string header;
+    while (header.empty() || isBlank(header)) {
+        if (!getline(file, header)) throw invalid_argument("CSV file has no header row.");
+        line_number++;
+    }
+    if (header.compare(0, 3, "\xEF\xBB\xBF") == 0) header.erase(0, 3); // UTF-8 byte order mark
+
+    const char* p = header.data();
+    const char* end = p + header.size();
+    while (true) {
+        const char* name_begin;
+        const char* name_end;
+        p = csvField(p, end, name_begin, name_end);
+        trim(name_begin, name_end);
+        int field = fieldIndex(name_begin, name_end);
+        if (field >= 0 && find(csv_columns.begin(), csv_columns.end(), field) != csv_columns.end()) {
+            throw invalid_argument(string("CSV header repeats the column ") + FIELD_NAMES[field]);
+        }
+        csv_columns.push_back(field);
+        if (p == end) break;
+        p++;
+    }
+    for (Field f : REQUIRED_FIELDS) {
+        if (find(csv_columns.begin(), csv_columns.end(), f) == csv_columns.end()) {
+            throw invalid_argument(string("CSV header is missing the column ") + FIELD_NAMES[f]);
+        }
+    }
+}
+
+bool FlexofferReader::has_next() {return file.peek() != ifstream::traits_type::eof();}
+
+size_t FlexofferReader::readChunk() {
+    size_t count = 0;
+    while (count < chunk_size) {
+        if (count == lines.size()) {
+            lines.emplace_back();
+            line_numbers.push_back(0);
+        }
+        if (!getline(file, lines[count])) break;
+        line_numbers[count] = ++line_number;
+        if (!isBlank(lines[count])) count++;
+    }
+    return count;
+}
+
+FlexofferBatch FlexofferReader::next_batch() {
+    INSTRUMENT_SCOPE("FlexofferReader::next_batch");
+    size_t count = readChunk();
+    size_t num_tasks = min<size_t>(resolve_num_threads(num_threads), max<size_t>(count / MIN_LINES_PER_TASK, 1));
+    vector<FlexofferBatch> parts(num_tasks);
+    vector<vector<FlexofferParseError>> part_errors(num_tasks);
+
+    parallel_for(num_tasks, num_threads, [&](size_t task) {
+        ParsedRows rows;
+        Row row;
+        for (size_t i = count * task / num_tasks; i < count * (task + 1) / num_tasks; i++) {
+            row.reset();
+            try {
+                if (jsonl) parseJsonLine(lines[i], row);
+                else parseCsvLine(lines[i], csv_columns, row);
+                rows.add(row);
+            } catch (const invalid_argument& e) {
+                part_errors[task].push_back({line_numbers[i], e.what()});
+            }
+        }
+        parts[task] = rows.toBatch();
+    });
+
+    FlexofferBatch batch = move(parts[0]);
+    for (size_t task = 1; task < num_tasks; task++) batch.append(parts[task]);
+    for (const auto& task_errors : part_errors) {
+        errors.insert(errors.end(), task_errors.begin(), task_errors.end());
+        INSTRUMENT_COUNT("FlexofferReader::next_batch", "errors", task_errors.size());
+    }
+    INSTRUMENT_COUNT("FlexofferReader::next_batch", "rows", count);
+    return batch;
+}
+
+vector<Flexoffer> FlexofferReader::next_flexoffers() {return next_batch().to_flexoffers();}
+
+const vector<FlexofferParseError>& FlexofferReader::get_errors() const {return errors;}
+
+void FlexofferReader::clear_errors() {errors.clear();}
+
+size_t FlexofferReader::lines_read() const {return line_number;}
+
+FlexofferBatch read_flexoffer_batch(const string& path, const string& format, int num_threads, bool skip_invalid) {
+    FlexofferReader reader(path, format, 65536, num_threads);
+    FlexofferBatch result;
+    while (reader.has_next()) {
+        FlexofferBatch chunk = reader.next_batch();
+        if (!skip_invalid && !reader.get_errors().empty()) {
+            const FlexofferParseError& error = reader.get_errors().front();
+            throw runtime_error("line " + to_string(error.line) + ": " + error.message);
+        }
+        result.append(chunk);
+    }
+    return result;
+}
+
+vector<Flexoffer> read_flexoffers(const string& path, const string& format, int num_threads, bool skip_invalid) {
+    FlexofferReader reader(path, format, 65536, num_threads);
+    vector<Flexoffer> flex_offers;
+    while (reader.has_next()) {
+        vector<Flexoffer> chunk = reader.next_flexoffers();
+        if (!skip_invalid && !reader.get_errors().empty()) {
+            const FlexofferParseError& error = reader.get_errors().front();
+            throw runtime_error("line " + to_string(error.line) + ": " + error.message);
+        }
+        flex_offers.insert(flex_offers.end(), make_move_iterator(chunk.begin()), make_move_iterator(chunk.end()));
+    }
+    return flex_offers;
+}
@@ -6,5 +6,7 @@ void Fo_Group::addFlexOffer(const Flexoffer& fo) {flexoffers.push_back(fo);}
 
 const std::vector<Flexoffer>& Fo_Group::getFlexOffers() const {return flexoffers;}
 
+std::vector<Flexoffer>& Fo_Group::getFlexOffers() {return flexoffers;}
+
 int Fo_Group::getGroupId() const {return id;}
 
@@ -1,9 +1,8 @@
 #include "../include/helpers.h"
+#include "../include/alignment.h"
+#include "../include/instrumentation.h"
 #include "../include/flexoffer.h"
-
-#include <pybind11/pybind11.h>
-#include <pybind11/stl.h>
-
+#include "../include/parallel.h"
 
 #include <vector>
 #include <tuple>
@@ -11,8 +10,8 @@
 #include <stdexcept>
 #include <string>
 #include <limits>
+#include <memory>
 
-namespace py = pybind11;
 using namespace std;
 
 int TIME_RESOLUTION = 3600; //default
@@ -23,6 +22,18 @@ void set_time_resolution(int resolution) { //Overwrite
     TIME_RESOLUTION = resolution;
 }
 
+int get_time_resolution() {return TIME_RESOLUTION;}
+
+int resolve_time_resolution(int resolution) {return resolution > 0 ? resolution : TIME_RESOLUTION;}
+
+// Adds `length` slices of source onto target; a plain loop over contiguous memory that the compiler vectorizes
+static void add_profile(TimeSlice* target, const TimeSlice* source, size_t length) {
+    for (size_t j = 0; j < length; j++) {
+        target[j].min_power += source[j].min_power;
+        target[j].max_power += source[j].max_power;
+    }
+}
+
 tuple<int, int> compute_aggregated_window(const vector<Flexoffer>& flex_offers) {
 
     time_t global_earliest = numeric_limits<int>::max();
@@ -45,13 +56,15 @@ tuple<int, int> compute_aggregated_window(const vector<Flexoffer>& flex_offers)
     return make_tuple(global_earliest, aggregated_latest);
 }
 
-vector<int> compute_offsets_and_length(const vector<Flexoffer>& flex_offers, time_t global_earliest, int& common_length) {
+vector<int> compute_offsets_and_length(const vector<Flexoffer>& flex_offers, time_t global_earliest, int& common_length,
+                                       int resolution) {
+    resolution = resolve_time_resolution(resolution);
     vector<int> offsets;
     offsets.reserve(flex_offers.size());
     common_length = 0;
 
     for (const auto& fo : flex_offers) {
-        int offset = static_cast<int>((fo.get_est() - global_earliest) / TIME_RESOLUTION);
+        int offset = static_cast<int>((fo.get_est() - global_earliest) / resolution);
         offsets.push_back(offset);
         common_length = max(common_length, offset + fo.get_duration());
     }
@@ -59,24 +72,111 @@ vector<int> compute_offsets_and_length(const vector<Flexoffer>& flex_offers, tim
     return offsets;
 }
 
-Flexoffer start_alignment_aggregate(const vector<Flexoffer>& flex_offers) {
+Flexoffer start_alignment_aggregate(const vector<Flexoffer>& flex_offers, int resolution) {
+    INSTRUMENT_SCOPE("start_alignment_aggregate");
 
     time_t global_earliest, aggregated_latest;
     tie(global_earliest, aggregated_latest) = compute_aggregated_window(flex_offers);
 
     int common_length;
-    vector<int> offsets = compute_offsets_and_length(flex_offers, global_earliest, common_length);
+    vector<int> offsets = compute_offsets_and_length(flex_offers, global_earliest, common_length, resolution);
 
     vector<TimeSlice> aggregated_profile(common_length, TimeSlice(0.0, 0.0));
 
     for (size_t i = 0; i < flex_offers.size(); i++) {
-        int offset = offsets[i];
-        const auto& profile = flex_offers[i].get_profile();
+        const auto& profile = flex_offers[i].get_profile_ref(); // No copy of the member profile
+        size_t length = min(profile.size(), static_cast<size_t>(max(flex_offers[i].get_duration(), 0)));
+        add_profile(aggregated_profile.data() + offsets[i], profile.data(), length);
+    }
+
+    return Flexoffer(
+        -1,
+        global_earliest,
+        aggregated_latest,
+        aggregated_latest,
+        aggregated_profile,
+        common_length,
+        0.0,
+        0.0
+    );
+}
+
+vector<Flexoffer> start_alignment_aggregate_groups(const vector<Fo_Group>& groups, int num_threads, int resolution) {
+    resolution = resolve_time_resolution(resolution);
+    INSTRUMENT_SCOPE("start_alignment_aggregate_groups");
+    vector<unique_ptr<Flexoffer>> aggregates(groups.size());
+
+    parallel_for(groups.size(), num_threads, [&](size_t g) {
+        aggregates[g].reset(new Flexoffer(start_alignment_aggregate(groups[g].getFlexOffers(), resolution)));
+    });
 
-        for (size_t j = 0; j < profile.size(); j++) {
-            int index = offset + j;
-            aggregated_profile[index].min_power += profile[j].min_power;
-            aggregated_profile[index].max_power += profile[j].max_power;
+    vector<Flexoffer> result;
+    result.reserve(groups.size());
+    for (const auto& aggregate : aggregates) result.push_back(*aggregate);
+    return result;
+}
+
+void disaggregate_start_aligned(const Flexoffer& aggregate, vector<Flexoffer>& members, int resolution) {
+    INSTRUMENT_SCOPE("disaggregate_start_aligned");
+    disaggregate_aligned(aggregate, vector<int>(members.size(), 0), members, resolution);
+}
+
+vector<Fo_Group> disaggregate_groups(const vector<Flexoffer>& aggregates, const vector<Fo_Group>& groups, int num_threads,
+                                     int resolution) {
+    INSTRUMENT_SCOPE("disaggregate_groups");
+    if (aggregates.size() != groups.size()) {
+        throw invalid_argument("Need exactly one aggregate per group.");
+    }
+
+    resolution = resolve_time_resolution(resolution);
+    vector<Fo_Group> result = groups;
+    parallel_for(result.size(), num_threads, [&](size_t g) {
+        disaggregate_start_aligned(aggregates[g], result[g].getFlexOffers(), resolution);
+    });
+    return result;
+}
+
+Flexoffer start_alignment_aggregate_batch(const FlexofferBatch& batch, const vector<int>& indices, int resolution) {
+    INSTRUMENT_SCOPE("start_alignment_aggregate_batch");
+    resolution = resolve_time_resolution(resolution);
+    vector<int> members = indices;
+    if (members.empty()) {
+        members.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); i++) members[i] = static_cast<int>(i);
+    }
+    if (members.empty()) {
+        throw invalid_argument("No flexoffers to aggregate.");
+    }
+
+    time_t global_earliest = numeric_limits<int>::max();
+    int min_flex = numeric_limits<int>::max();
+    for (int i : members) {
+        if (i < 0 || static_cast<size_t>(i) >= batch.size()) throw out_of_range("Offer index out of range.");
+        int flex = batch.latest_start[i] - batch.earliest_start[i];
+        global_earliest = min(global_earliest, batch.earliest_start[i]);
+        min_flex = min(min_flex, flex);
+    }
+    time_t aggregated_latest = global_earliest + min_flex;
+
+    int common_length = 0;
+    vector<int> offsets;
+    offsets.reserve(members.size());
+    for (int i : members) {
+        int offset = static_cast<int>((batch.earliest_start[i] - global_earliest) / resolution);
+        offsets.push_back(offset);
+        common_length = max(common_length, offset + batch.duration[i]);
+    }
+
+    vector<TimeSlice> aggregated_profile(common_length, TimeSlice(0.0, 0.0));
+    for (size_t m = 0; m < members.size(); m++) {
+        size_t begin = batch.profile_offsets[members[m]];
+        size_t length = min(batch.profile_offsets[members[m] + 1] - begin,
+                            static_cast<size_t>(max(batch.duration[members[m]], 0)));
+        size_t end = begin + length; // The aggregate only has room for duration slices
+        TimeSlice* target = aggregated_profile.data() + offsets[m];
+        for (size_t k = begin; k < end; k++) {
+            target[k - begin].min_power += batch.min_power[k];
+            target[k - begin].max_power += batch.max_power[k];
         }
     }
 
@@ -90,4 +190,4 @@ Flexoffer start_alignment_aggregate(const vector<Flexoffer>& flex_offers) {
         0.0,
         0.0
     );
-}
\ No newline at end of file
+}
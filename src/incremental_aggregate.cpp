@@ -0,0 +1,127 @@
+#include "../include/incremental_aggregate.h"
+#include "../include/helpers.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+IncrementalAggregate::IncrementalAggregate(int resolution)
+    : resolution(resolve_time_resolution(resolution)), has_anchor(false), anchor(0), base_slot(0) {}
+
+long long IncrementalAggregate::slotOf(time_t timestamp) const {
+    long long delta = static_cast<long long>(timestamp - anchor);
+    long long slot = delta / resolution;
+    return (delta % resolution != 0 && delta < 0) ? slot - 1 : slot; // Floor, also before the anchor
+}
+
+void IncrementalAggregate::add(const Flexoffer& fo) {
+    if (members.count(fo.get_offer_id())) {
+        throw invalid_argument("Flexoffer " + to_string(fo.get_offer_id()) + " is already part of the aggregate.");
+    }
+    if (!has_anchor) {
+        has_anchor = true;
+        anchor = fo.get_est();
+    }
+
+    Member member;
+    member.earliest_start = fo.get_est();
+    member.flexibility = static_cast<int>(fo.get_lst() - fo.get_est());
+    member.first_slot = slotOf(fo.get_est());
+    member.end_slot = member.first_slot + fo.get_duration();
+    const auto& profile = fo.get_profile_ref();
+    member.profile.assign(profile.begin(), profile.begin() + min(profile.size(), static_cast<size_t>(max(fo.get_duration(), 0))));
+
+    // Grow the running sum so it covers the member's slots
+    long long last_slot = member.end_slot;
+    if (profile_sum.empty()) base_slot = member.first_slot;
+    while (base_slot > member.first_slot) {
+        profile_sum.push_front(TimeSlice(0.0, 0.0));
+        base_slot--;
+    }
+    while (base_slot + static_cast<long long>(profile_sum.size()) < last_slot) {
+        profile_sum.push_back(TimeSlice(0.0, 0.0));
+    }
+
+    for (size_t j = 0; j < member.profile.size(); j++) {
+        TimeSlice& slice = profile_sum[member.first_slot - base_slot + j];
+        slice.min_power += member.profile[j].min_power;
+        slice.max_power += member.profile[j].max_power;
+    }
+
+    earliest_starts.insert(member.earliest_start);
+    flexibilities.insert(member.flexibility);
+    end_slots.insert(member.end_slot);
+    members.emplace(fo.get_offer_id(), move(member));
+}
+
+bool IncrementalAggregate::remove(int offer_id) {
+    auto it = members.find(offer_id);
+    if (it == members.end()) return false;
+
+    const Member& member = it->second;
+    for (size_t j = 0; j < member.profile.size(); j++) {
+        TimeSlice& slice = profile_sum[member.first_slot - base_slot + j];
+        slice.min_power -= member.profile[j].min_power;
+        slice.max_power -= member.profile[j].max_power;
+    }
+
+    earliest_starts.erase(earliest_starts.find(member.earliest_start));
+    flexibilities.erase(flexibilities.find(member.flexibility));
+    end_slots.erase(end_slots.find(member.end_slot));
+    members.erase(it);
+
+    trim();
+    return true;
+}
+
+/** Drops slots no member covers anymore, so the sum does not grow while offers come and go during the day. */
+void IncrementalAggregate::trim() {
+    if (members.empty()) { // Start over, which also discards rounding left behind by the subtractions
+        profile_sum.clear();
+        base_slot = 0;
+        return;
+    }
+
+    long long first_slot = slotOf(*earliest_starts.begin());
+    long long last_slot = *end_slots.rbegin();
+    while (base_slot < first_slot) {
+        profile_sum.pop_front();
+        base_slot++;
+    }
+    while (base_slot + static_cast<long long>(profile_sum.size()) > last_slot) {
+        profile_sum.pop_back();
+    }
+}
+
+bool IncrementalAggregate::contains(int offer_id) const {return members.count(offer_id) > 0;}
+
+size_t IncrementalAggregate::size() const {return members.size();}
+
+Flexoffer IncrementalAggregate::aggregate() const {
+    if (members.empty()) {
+        throw runtime_error("Cannot build the aggregate of an empty IncrementalAggregate.");
+    }
+
+    time_t global_earliest = *earliest_starts.begin();
+    time_t aggregated_latest = global_earliest + *flexibilities.begin();
+    long long first_slot = slotOf(global_earliest);
+    int common_length = static_cast<int>(*end_slots.rbegin() - first_slot);
+
+    vector<TimeSlice> aggregated_profile(common_length, TimeSlice(0.0, 0.0));
+    for (int j = 0; j < common_length; j++) {
+        long long index = first_slot - base_slot + j;
+        if (index < static_cast<long long>(profile_sum.size())) aggregated_profile[j] = profile_sum[index];
+    }
+
+    return Flexoffer(
+        -1,
+        global_earliest,
+        aggregated_latest,
+        aggregated_latest,
+        aggregated_profile,
+        common_length,
+        0.0,
+        0.0
+    );
+}
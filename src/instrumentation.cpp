@@ -0,0 +1,191 @@
+#include "../include/instrumentation.h"
+
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+atomic<bool> instrumentation_flag(false);
+static atomic<bool> trace_flag(false);
+
+// Beyond this a thread stops recording trace events (they are counted as dropped), stats keep going
+static const size_t MAX_TRACE_EVENTS_PER_THREAD = 1 << 20;
+
+static const chrono::steady_clock::time_point clock_epoch = chrono::steady_clock::now();
+
+struct ScopeStats {
+    long long calls = 0;
+    long long total_ns = 0;
+    unordered_map<const char*, long long> counters;
+};
+
+struct TraceEvent {
+    const char* name;
+    long long start_ns;
+    long long end_ns;
+    int tid;
+};
+
+/** 🔹 Stats of one thread. Only its own thread writes them, so the lock is uncontended except while reading. */
+struct ThreadState {
+    mutex lock;
+    int tid = 0;
+    unordered_map<const char*, ScopeStats> stats;
+    vector<TraceEvent> events;
+};
+
+/** 🔹 All threads that recorded something. Threads from parallel_for come and go, so a finishing thread
+ *  folds its stats and events into the retired totals instead of staying registered. */
+struct Registry {
+    mutex lock;
+    vector<shared_ptr<ThreadState>> threads;
+    map<string, map<string, long long>> retired_stats;
+    vector<TraceEvent> retired_events;
+    long long dropped_events = 0;
+    int next_tid = 1;
+};
+
+static Registry& registry() {
+    static Registry* instance = new Registry(); // Never destroyed, threads may still retire during shutdown
+    return *instance;
+}
+
+static void addStats(map<string, map<string, long long>>& totals, const ThreadState& state) {
+    for (const auto& entry : state.stats) {
+        map<string, long long>& total = totals[entry.first];
+        if (entry.second.calls > 0) { // Names that only have counters (e.g. "materialize_dfo") get no timing
+            total["calls"] += entry.second.calls;
+            total["total_ns"] += entry.second.total_ns;
+        }
+        for (const auto& counter : entry.second.counters) total[counter.first] += counter.second;
+    }
+}
+
+struct ThreadHandle {
+    shared_ptr<ThreadState> state;
+
+    ThreadHandle() : state(make_shared<ThreadState>()) {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        state->tid = r.next_tid++;
+        r.threads.push_back(state);
+    }
+
+    ~ThreadHandle() {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        lock_guard<mutex> state_guard(state->lock);
+        addStats(r.retired_stats, *state);
+        r.retired_events.insert(r.retired_events.end(), state->events.begin(), state->events.end());
+        for (size_t i = 0; i < r.threads.size(); i++) {
+            if (r.threads[i] == state) {
+                r.threads.erase(r.threads.begin() + i);
+                break;
+            }
+        }
+    }
+};
+
+static ThreadState& threadState() {
+    thread_local ThreadHandle handle;
+    return *handle.state;
+}
+
+void set_instrumentation(bool enabled, bool trace) {
+    trace_flag.store(enabled && trace);
+    instrumentation_flag.store(enabled);
+}
+
+void reset_instrumentation() {
+    Registry& r = registry();
+    lock_guard<mutex> guard(r.lock);
+    r.retired_stats.clear();
+    r.retired_events.clear();
+    r.dropped_events = 0;
+    for (const auto& state : r.threads) {
+        lock_guard<mutex> state_guard(state->lock);
+        state->stats.clear();
+        state->events.clear();
+    }
+}
+
+long long instrumentation_now_ns() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - clock_epoch).count();
+}
+
+void instrumentation_record(const char* name, long long start_ns, long long end_ns) {
+    ThreadState& state = threadState();
+    bool dropped = false;
+    {
+        lock_guard<mutex> guard(state.lock);
+        ScopeStats& stats = state.stats[name];
+        stats.calls++;
+        stats.total_ns += end_ns - start_ns;
+        if (trace_flag.load(memory_order_relaxed)) {
+            if (state.events.size() < MAX_TRACE_EVENTS_PER_THREAD) state.events.push_back({name, start_ns, end_ns, state.tid});
+            else dropped = true;
+        }
+    }
+    if (dropped) {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        r.dropped_events++;
+    }
+}
+
+void instrumentation_count(const char* name, const char* counter, long long amount) {
+    ThreadState& state = threadState();
+    lock_guard<mutex> guard(state.lock);
+    state.stats[name].counters[counter] += amount;
+}
+
+map<string, map<string, long long>> get_instrumentation_stats() {
+    Registry& r = registry();
+    lock_guard<mutex> guard(r.lock);
+    map<string, map<string, long long>> totals = r.retired_stats;
+    for (const auto& state : r.threads) {
+        lock_guard<mutex> state_guard(state->lock);
+        addStats(totals, *state);
+    }
+    return totals;
+}
+
+string get_instrumentation_trace() {
+    vector<TraceEvent> events;
+    long long dropped_events;
+    {
+        Registry& r = registry();
+        lock_guard<mutex> guard(r.lock);
+        events = r.retired_events;
+        dropped_events = r.dropped_events;
+        for (const auto& state : r.threads) {
+            lock_guard<mutex> state_guard(state->lock);
+            events.insert(events.end(), state->events.begin(), state->events.end());
+        }
+    }
+
+    // Complete ("X") events with timestamps in microseconds, as the trace-event format expects
+    ostringstream out;
+    out.precision(3);
+    out << fixed << "{\"traceEvents\": [";
+    for (size_t i = 0; i < events.size(); i++) {
+        out << (i ? ",\n" : "\n") << "{\"name\": \"" << events[i].name << "\", \"cat\": \"flexoffer_logic\", \"ph\": \"X\""
+            << ", \"ts\": " << events[i].start_ns / 1000.0 << ", \"dur\": " << (events[i].end_ns - events[i].start_ns) / 1000.0
+            << ", \"pid\": 1, \"tid\": " << events[i].tid << "}";
+    }
+    out << "\n], \"displayTimeUnit\": \"ns\", \"otherData\": {\"dropped_events\": " << dropped_events << "}}\n";
+    return out.str();
+}
+
+void write_instrumentation_trace(const string& path) {
+    ofstream file(path);
+    if (!file) throw runtime_error("Could not open " + path + " for writing");
+    file << get_instrumentation_trace();
+}
@@ -0,0 +1,155 @@
+#include "../include/online_clusterer.h"
+#include "../include/instrumentation.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using namespace std;
+
+OnlineClusterer::OnlineClusterer(int est_threshold, int lst_threshold, int max_group_size)
+    : est_threshold(est_threshold), lst_threshold(lst_threshold), max_group_size(max_group_size), next_group_id(0),
+      open_groups(est_threshold, lst_threshold) {
+    if (max_group_size < 1) {
+        throw invalid_argument("max_group_size must be at least 1.");
+    }
+}
+
+/** 🔹 Helper function: hours since the Unix epoch. Unlike the hour of day of Flexoffer::get_est_hour, it tells
+ *  apart the same hour on different days of the stream. */
+static int absoluteHour(time_t timestamp) {
+    time_t hour = timestamp / 3600;
+    return static_cast<int>(timestamp % 3600 < 0 ? hour - 1 : hour);
+}
+
+/** 🔹 Helper function: the open group nearest to a new offer by MBR centroid (the distance of clusterMBRs),
+ *  the lowest id on ties, or -1 if no group can take it. */
+int OnlineClusterer::nearestOpenGroup(int est_hour, int lst_hour) const {
+    int best = -1;
+    double best_distance = 0.0;
+    for (int group_id : open_groups.mergeCandidates(MBR{est_hour, est_hour, lst_hour, lst_hour})) {
+        const MBR& mbr = groups.at(group_id).mbr;
+        double dx = (mbr.min_est_hour + mbr.max_est_hour) / 2.0 - est_hour;
+        double dy = (mbr.min_lst_hour + mbr.max_lst_hour) / 2.0 - lst_hour;
+        double distance = sqrt(dx * dx + dy * dy);
+        if (best == -1 || distance < best_distance || (distance == best_distance && group_id < best)) {
+            best = group_id;
+            best_distance = distance;
+        }
+    }
+    return best;
+}
+
+/** 🔹 Helper function: recomputes the MBR of a group from its members' hours and files it in the grid
+ *  while it has room. */
+void OnlineClusterer::refreshMBR(int group_id, Group& group) {
+    group.mbr = MBR{*group.est_hours.begin(), *group.est_hours.rbegin(), *group.lst_hours.begin(), *group.lst_hours.rbegin()};
+    if (static_cast<int>(group.offers.size()) < max_group_size) {
+        open_groups.update(group_id, group.mbr);
+    } else {
+        open_groups.remove(group_id);
+    }
+}
+
+int OnlineClusterer::insert(const Flexoffer& fo) {
+    INSTRUMENT_SCOPE("OnlineClusterer::insert");
+    if (placements.count(fo.get_offer_id())) {
+        throw invalid_argument("Offer " + to_string(fo.get_offer_id()) + " is already clustered.");
+    }
+
+    int group_id = nearestOpenGroup(absoluteHour(fo.get_est()), absoluteHour(fo.get_lst()));
+    if (group_id == -1) group_id = next_group_id++;
+
+    Group& group = groups[group_id];
+    placements[fo.get_offer_id()] = Placement{group_id, group.offers.size(), expiries.emplace(fo.get_lst(), fo.get_offer_id())};
+    group.offers.push_back(fo);
+    group.est_hours.insert(absoluteHour(fo.get_est()));
+    group.lst_hours.insert(absoluteHour(fo.get_lst()));
+    refreshMBR(group_id, group);
+    changed.insert(group_id);
+    return group_id;
+}
+
+vector<int> OnlineClusterer::insert_many(const vector<Flexoffer>& flex_offers) {
+    vector<int> group_ids;
+    group_ids.reserve(flex_offers.size());
+    for (const Flexoffer& fo : flex_offers) group_ids.push_back(insert(fo));
+    return group_ids;
+}
+
+bool OnlineClusterer::remove(int offer_id) {
+    INSTRUMENT_SCOPE("OnlineClusterer::remove");
+    auto placement = placements.find(offer_id);
+    if (placement == placements.end()) return false;
+
+    int group_id = placement->second.group_id;
+    Group& group = groups.at(group_id);
+    const Flexoffer& fo = group.offers[placement->second.position];
+    group.est_hours.erase(group.est_hours.find(absoluteHour(fo.get_est())));
+    group.lst_hours.erase(group.lst_hours.find(absoluteHour(fo.get_lst())));
+
+    // Swap-remove, fixing the position of the moved offer
+    size_t position = placement->second.position;
+    if (position + 1 != group.offers.size()) {
+        group.offers[position] = move(group.offers.back());
+        placements.at(group.offers[position].get_offer_id()).position = position;
+    }
+    group.offers.pop_back();
+    expiries.erase(placement->second.expiry);
+    placements.erase(placement);
+
+    if (group.offers.empty()) {
+        open_groups.remove(group_id);
+        groups.erase(group_id);
+    } else {
+        refreshMBR(group_id, group);
+    }
+    changed.insert(group_id);
+    return true;
+}
+
+vector<int> OnlineClusterer::remove_expired(time_t now) {
+    vector<int> expired;
+    for (auto it = expiries.begin(); it != expiries.end() && it->first < now; ++it) expired.push_back(it->second);
+    for (int offer_id : expired) remove(offer_id);
+    return expired;
+}
+
+vector<int> OnlineClusterer::take_changed_groups() {
+    vector<int> result(changed.begin(), changed.end());
+    changed.clear();
+    return result;
+}
+
+bool OnlineClusterer::contains(int offer_id) const {return placements.count(offer_id) > 0;}
+
+bool OnlineClusterer::has_group(int group_id) const {return groups.count(group_id) > 0;}
+
+int OnlineClusterer::group_of(int offer_id) const {
+    auto placement = placements.find(offer_id);
+    return placement == placements.end() ? -1 : placement->second.group_id;
+}
+
+Fo_Group OnlineClusterer::get_group(int group_id) const {
+    auto group = groups.find(group_id);
+    if (group == groups.end()) throw out_of_range("No group " + to_string(group_id) + ".");
+    Fo_Group result(group_id);
+    for (const Flexoffer& fo : group->second.offers) result.addFlexOffer(fo);
+    return result;
+}
+
+vector<Fo_Group> OnlineClusterer::get_groups() const {
+    vector<int> group_ids;
+    group_ids.reserve(groups.size());
+    for (const auto& entry : groups) group_ids.push_back(entry.first);
+    sort(group_ids.begin(), group_ids.end());
+
+    vector<Fo_Group> result;
+    result.reserve(group_ids.size());
+    for (int group_id : group_ids) result.push_back(get_group(group_id));
+    return result;
+}
+
+size_t OnlineClusterer::size() const {return placements.size();}
+
+size_t OnlineClusterer::num_groups() const {return groups.size();}
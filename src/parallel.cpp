@@ -0,0 +1,50 @@
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+int resolve_num_threads(int num_threads) {
+    if (num_threads > 0) return num_threads;
+    unsigned int hw = thread::hardware_concurrency();
+    return hw == 0 ? 1 : static_cast<int>(hw);
+}
+
+void parallel_for(size_t count, int num_threads, const function<void(size_t)>& body) {
+    if (count == 0) return;
+
+    size_t workers = min(static_cast<size_t>(resolve_num_threads(num_threads)), count);
+    if (workers <= 1) { // No point spinning up threads for a single worker
+        for (size_t i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    atomic<size_t> next_index(0);
+    exception_ptr first_error;
+    mutex error_mutex;
+
+    auto worker = [&]() {
+        for (size_t i = next_index++; i < count; i = next_index++) {
+            try {
+                body(i);
+            } catch (...) {
+                lock_guard<mutex> lock(error_mutex);
+                if (!first_error) first_error = current_exception();
+                next_index = count; // Stop handing out work
+            }
+        }
+    };
+
+    vector<thread> threads;
+    threads.reserve(workers - 1);
+    for (size_t t = 1; t < workers; t++) threads.emplace_back(worker);
+    worker(); // The calling thread takes part as well
+    for (auto& th : threads) th.join();
+
+    if (first_error) rethrow_exception(first_error);
+}
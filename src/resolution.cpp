@@ -0,0 +1,146 @@
+#include "../include/resolution.h"
+#include "../include/DFO_aggregation.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+
+/** 🔹 Helper function: Number of fine timesteps per coarse timestep. */
+static int coarseningFactor(int resolution, int coarse_resolution) {
+    if (resolution <= 0 || coarse_resolution <= 0) {
+        throw invalid_argument("Resolutions must be positive numbers of seconds per timestep.");
+    }
+    if (coarse_resolution % resolution != 0) {
+        throw invalid_argument("coarse_resolution must be a multiple of resolution.");
+    }
+    return coarse_resolution / resolution;
+}
+
+DFO coarsen_dfo(const DFO& dfo, int resolution, int coarse_resolution) {
+    INSTRUMENT_SCOPE("coarsen_dfo");
+    size_t factor = static_cast<size_t>(coarseningFactor(resolution, coarse_resolution));
+    size_t length = dfo.polygons.size();
+    int numsamples = length > 0 ? dfo.polygons[0].numsamples : 5;
+
+    DFO coarse(dfo.dfo_id, {0}, {0}, numsamples, dfo.charging_power * factor,
+               dfo.min_total_energy, dfo.max_total_energy, dfo.earliest_start);
+    coarse.latest_start = dfo.latest_start;
+    coarse.polygons.clear();
+    coarse.polygons.reserve((length + factor - 1) / factor);
+
+    vector<double> samples;
+    for (size_t first = 0; first < length; first += factor) {
+        size_t last = min(length, first + factor);
+        const DependencyPolygon& polygon = dfo.polygons[first];
+
+        // Sample at the x values of the first fine polygon, so its breakpoints survive
+        samples.clear();
+        PolygonView view(polygon.points);
+        if (view.valid()) {
+            for (size_t k = 0; k < view.size(); k++) samples.push_back(view.x(k));
+        } else {
+            int count = max(polygon.numsamples, 2);
+            double step = (polygon.max_prev_energy - polygon.min_prev_energy) / (count - 1);
+            for (int k = 0; k < count; k++) samples.push_back(polygon.min_prev_energy + k * step);
+        }
+
+        // The least energy path from x keeps taking the minimum usage and the most energy path the maximum;
+        // both end at the extremes as long as dependency + usage does not decrease in the dependency
+        DependencyPolygon coarse_polygon(polygon.min_prev_energy, polygon.max_prev_energy, polygon.numsamples);
+        coarse_polygon.points.reserve(2 * samples.size());
+        for (double x : samples) {
+            double min_usage = 0.0, max_usage = 0.0;
+            for (size_t t = first; t < last; t++) {
+                double min_energy, max_energy, unused;
+                DFO_Aggregation::usageAt(dfo.polygons[t], x + min_usage, min_energy, unused);
+                DFO_Aggregation::usageAt(dfo.polygons[t], x + max_usage, unused, max_energy);
+                min_usage += min_energy;
+                max_usage += max_energy;
+            }
+            coarse_polygon.points.emplace_back(x, min_usage);
+            coarse_polygon.points.emplace_back(x, max_usage);
+        }
+        coarse.polygons.push_back(move(coarse_polygon));
+    }
+    return coarse;
+}
+
+vector<DFO> coarsen_dfos(const vector<DFO>& dfos, int resolution, int coarse_resolution, int num_threads) {
+    coarseningFactor(resolution, coarse_resolution); // Fail before starting any threads
+    vector<DFO> result(dfos.size(), DFO(-1, {0}, {0}));
+    parallel_for(dfos.size(), num_threads, [&](size_t i) {
+        result[i] = coarsen_dfo(dfos[i], resolution, coarse_resolution);
+    });
+    return result;
+}
+
+Flexoffer coarsen_flexoffer(const Flexoffer& fo, int resolution, int coarse_resolution) {
+    int factor = coarseningFactor(resolution, coarse_resolution);
+    const auto& profile = fo.get_profile_ref();
+    int duration = max(fo.get_duration(), 0);
+    int length = min(duration, static_cast<int>(profile.size()));
+    int coarse_duration = (duration + factor - 1) / factor;
+
+    vector<TimeSlice> coarse_profile(coarse_duration, TimeSlice(0.0, 0.0));
+    for (int j = 0; j < length; j++) {
+        coarse_profile[j / factor].min_power += profile[j].min_power / factor;
+        coarse_profile[j / factor].max_power += profile[j].max_power / factor;
+    }
+
+    time_t est = fo.get_est();
+    time_t lst = est + (fo.get_lst() - est) / coarse_resolution * coarse_resolution;
+    time_t et = max(fo.get_et(), lst + static_cast<time_t>(coarse_duration) * coarse_resolution);
+
+    Flexoffer coarse(fo.get_offer_id(), est, lst, et, coarse_profile, coarse_duration,
+                     fo.get_min_overall_alloc(), fo.get_max_overall_alloc());
+
+    const auto& allocation = fo.get_scheduled_allocation_ref();
+    vector<double>& coarse_allocation = coarse.get_scheduled_allocation_ref();
+    for (size_t j = 0; j < allocation.size() && j / factor < coarse_allocation.size(); j++) {
+        coarse_allocation[j / factor] += allocation[j] / factor;
+    }
+    coarse.set_scheduled_start_time(fo.get_scheduled_start_time());
+    return coarse;
+}
+
+vector<Flexoffer> coarsen_flexoffers(const vector<Flexoffer>& fos, int resolution, int coarse_resolution, int num_threads) {
+    INSTRUMENT_SCOPE("coarsen_flexoffers");
+    coarseningFactor(resolution, coarse_resolution);
+    vector<TimeSlice> empty;
+    vector<Flexoffer> result(fos.size(), Flexoffer(-1, 0, 0, 0, empty, 0));
+    parallel_for(fos.size(), num_threads, [&](size_t i) {
+        result[i] = coarsen_flexoffer(fos[i], resolution, coarse_resolution);
+    });
+    return result;
+}
+
+void refine_flexoffer_schedule(const Flexoffer& coarse, Flexoffer& fine, int resolution, int coarse_resolution) {
+    int factor = coarseningFactor(resolution, coarse_resolution);
+    const auto& profile = fine.get_profile_ref();
+    const auto& coarse_allocation = coarse.get_scheduled_allocation_ref();
+    vector<double>& allocation = fine.get_scheduled_allocation_ref();
+    allocation.assign(max(fine.get_duration(), 0), 0.0);
+
+    size_t length = min(profile.size(), allocation.size());
+    for (size_t first = 0; first < length; first += factor) {
+        size_t last = min(length, first + factor);
+        double total_min = 0.0, total_max = 0.0;
+        for (size_t j = first; j < last; j++) {
+            total_min += profile[j].min_power;
+            total_max += profile[j].max_power;
+        }
+
+        // Energy of the coarse slot in fine slot units, as a share of the fine slots' headroom
+        size_t slot = first / factor;
+        double allocated = slot < coarse_allocation.size() ? coarse_allocation[slot] * factor : 0.0;
+        double headroom = total_max - total_min;
+        double fraction = headroom > 0.0 ? min(max((allocated - total_min) / headroom, 0.0), 1.0) : 0.0;
+        for (size_t j = first; j < last; j++) {
+            allocation[j] = profile[j].min_power + fraction * (profile[j].max_power - profile[j].min_power);
+        }
+    }
+    fine.set_scheduled_start_time(coarse.get_scheduled_start_time());
+}
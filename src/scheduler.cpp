@@ -0,0 +1,130 @@
+#include "../include/scheduler.h"
+#include "../include/helpers.h"
+#include "../include/instrumentation.h"
+#include "../include/parallel.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+
+/** 🔹 Helper function: Slot of the price vector a timestamp falls into, rounding down. Starts off the price
+ *  grid are charged the price of the slot they start in. */
+static long long priceSlot(time_t timestamp, time_t price_start, int resolution) {
+    long long offset = static_cast<long long>(timestamp - price_start);
+    return offset >= 0 ? offset / resolution : -((-offset + resolution - 1) / resolution);
+}
+
+/** 🔹 Helper function: Rejects offers whose overall allocation bounds no allocation within the profile meets.
+ *  Offers with both bounds 0 (the default) set no overall bounds. */
+static void checkOverallBounds(const Flexoffer& fo, double min_profile_energy, double max_profile_energy) {
+    double min_overall = fo.get_min_overall_alloc(), max_overall = fo.get_max_overall_alloc();
+    if (min_overall == 0.0 && max_overall == 0.0) return;
+
+    double tolerance = 1e-9 * (1.0 + max_profile_energy);
+    string offer = "Offer " + to_string(fo.get_offer_id());
+    if (min_overall > max_overall) {
+        throw invalid_argument(offer + " has min_overall_alloc above max_overall_alloc.");
+    }
+    if (min_overall > max_profile_energy + tolerance) {
+        throw invalid_argument(offer + " cannot reach min_overall_alloc within its max_power profile.");
+    }
+    if (min_profile_energy > max_overall + tolerance) {
+        throw invalid_argument(offer + " exceeds max_overall_alloc with its min_power profile alone.");
+    }
+}
+
+/** 🔹 Scheduling core, with the prefix sums of the prices computed once per batch. */
+static double scheduleWithPrefix(Flexoffer& fo, const vector<double>& prices, const vector<double>& prefix,
+                                 time_t price_start, int resolution) {
+    const auto& profile = fo.get_profile_ref();
+    long long duration = static_cast<long long>(min(static_cast<size_t>(max(fo.get_duration(), 0)), profile.size()));
+    long long num_prices = static_cast<long long>(prices.size());
+
+    // Cheapest window of `duration` slots over the starts in [EST, LST]
+    long long first_slot = priceSlot(fo.get_est(), price_start, resolution);
+    long long num_starts = static_cast<long long>((fo.get_lst() - fo.get_est()) / resolution) + 1;
+    long long best_start = -1, best_slot = -1;
+    double best_sum = 0.0;
+    for (long long k = max(0LL, -first_slot); k < num_starts; k++) {
+        long long slot = first_slot + k;
+        if (slot + duration > num_prices) break;
+        double window_sum = prefix[slot + duration] - prefix[slot];
+        if (best_slot < 0 || window_sum < best_sum) {
+            best_start = k;
+            best_slot = slot;
+            best_sum = window_sum;
+        }
+    }
+    if (best_slot < 0) {
+        throw invalid_argument("No start of offer " + to_string(fo.get_offer_id()) + " lies within the price horizon.");
+    }
+
+    // Minimum profile first, then the cheapest slots for the remaining minimum energy
+    double hours = resolution / 3600.0;
+    vector<double> allocation(max(fo.get_duration(), 0), 0.0);
+    double energy = 0.0, max_energy = 0.0;
+    for (long long j = 0; j < duration; j++) {
+        allocation[j] = profile[j].min_power;
+        energy += allocation[j] * hours;
+        max_energy += profile[j].max_power * hours;
+    }
+    checkOverallBounds(fo, energy, max_energy);
+
+    vector<int> order(duration);
+    iota(order.begin(), order.end(), 0);
+    const double* window = prices.data() + best_slot;
+    stable_sort(order.begin(), order.end(), [&](int a, int b) { return window[a] < window[b]; });
+
+    for (int j : order) {
+        double missing = fo.get_min_overall_alloc() - energy;
+        if (missing <= 0.0) break;
+        double added = min((profile[j].max_power - allocation[j]) * hours, missing);
+        if (added <= 0.0) continue;
+        allocation[j] += added / hours;
+        energy += added;
+    }
+
+    // Energy that is paid for to take is worth taking as long as the offer allows more
+    for (int j : order) {
+        if (window[j] >= 0.0) break;
+        double room = fo.get_max_overall_alloc() - energy;
+        if (room <= 0.0) break;
+        double added = min((profile[j].max_power - allocation[j]) * hours, room);
+        if (added <= 0.0) continue;
+        allocation[j] += added / hours;
+        energy += added;
+    }
+
+    double cost = 0.0;
+    for (long long j = 0; j < duration; j++) cost += window[j] * allocation[j] * hours;
+
+    fo.set_scheduled_start_time(fo.get_est() + static_cast<time_t>(best_start) * resolution);
+    fo.set_scheduled_allocation(move(allocation));
+    return cost;
+}
+
+static vector<double> pricePrefix(const vector<double>& prices) {
+    vector<double> prefix(prices.size() + 1, 0.0);
+    for (size_t k = 0; k < prices.size(); k++) prefix[k + 1] = prefix[k] + prices[k];
+    return prefix;
+}
+
+double schedule_flexoffer(Flexoffer& fo, const vector<double>& prices, time_t price_start, int resolution) {
+    return scheduleWithPrefix(fo, prices, pricePrefix(prices), price_start, resolve_time_resolution(resolution));
+}
+
+vector<double> schedule_flexoffers(vector<Flexoffer>& flex_offers, const vector<double>& prices, time_t price_start,
+                                   int resolution, int num_threads) {
+    INSTRUMENT_SCOPE("schedule_flexoffers");
+    resolution = resolve_time_resolution(resolution);
+    vector<double> prefix = pricePrefix(prices);
+    vector<double> costs(flex_offers.size(), 0.0);
+    parallel_for(flex_offers.size(), num_threads, [&](size_t i) {
+        costs[i] = scheduleWithPrefix(flex_offers[i], prices, prefix, price_start, resolution);
+    });
+    INSTRUMENT_COUNT("schedule_flexoffers", "offers", flex_offers.size());
+    return costs;
+}
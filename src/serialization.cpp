@@ -0,0 +1,498 @@
+#include "../include/serialization.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+static const char SNAPSHOT_MAGIC[4] = {'F', 'L', 'X', 'O'};
+static const uint16_t SNAPSHOT_VERSION = 1;
+
+enum SnapshotKind : uint16_t {
+    FLEXOFFER_SNAPSHOT = 1,
+    DFO_SNAPSHOT = 2,
+    GROUP_SNAPSHOT = 3
+};
+
+static bool hostIsLittleEndian() {
+    uint16_t probe = 1;
+    unsigned char first;
+    memcpy(&first, &probe, 1);
+    return first == 1;
+}
+
+// Converts between host and little-endian byte order (the same operation in both directions)
+template <typename T>
+static void swapToLittleEndian(T* values, size_t count) {
+    if (hostIsLittleEndian()) return;
+    for (size_t i = 0; i < count; i++) {
+        unsigned char bytes[sizeof(T)];
+        memcpy(bytes, &values[i], sizeof(T));
+        reverse(bytes, bytes + sizeof(T));
+        memcpy(&values[i], bytes, sizeof(T));
+    }
+}
+
+class SnapshotWriter {
+private:
+    string buffer;
+
+public:
+    void header(SnapshotKind kind, uint64_t count) {
+        buffer.append(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        scalar<uint16_t>(SNAPSHOT_VERSION);
+        scalar<uint16_t>(kind);
+        scalar<uint64_t>(count);
+    }
+
+    template <typename T>
+    void scalar(T value) {
+        swapToLittleEndian(&value, 1);
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    // Byte length, raw array, then zero padding up to the next 8 byte boundary
+    template <typename T>
+    void section(const vector<T>& values) {
+        uint64_t bytes = values.size() * sizeof(T);
+        scalar<uint64_t>(bytes);
+        if (hostIsLittleEndian()) {
+            buffer.append(reinterpret_cast<const char*>(values.data()), bytes);
+        } else {
+            vector<T> swapped = values;
+            swapToLittleEndian(swapped.data(), swapped.size());
+            buffer.append(reinterpret_cast<const char*>(swapped.data()), bytes);
+        }
+        buffer.append((8 - bytes % 8) % 8, '\0');
+    }
+
+    string& str() { return buffer; }
+};
+
+class SnapshotReader {
+private:
+    const char* data;
+    size_t size;
+    size_t pos;
+
+    void require(size_t bytes) const {
+        if (bytes > size - pos) throw runtime_error("Snapshot is truncated.");
+    }
+
+public:
+    SnapshotReader(const char* data, size_t size) : data(data), size(size), pos(0) {}
+
+    uint64_t header(SnapshotKind expected_kind) {
+        require(sizeof(SNAPSHOT_MAGIC));
+        if (memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0) throw runtime_error("Not a flexoffer_logic snapshot.");
+        pos += sizeof(SNAPSHOT_MAGIC);
+        if (scalar<uint16_t>() != SNAPSHOT_VERSION) throw runtime_error("Unsupported snapshot version.");
+        if (scalar<uint16_t>() != expected_kind) throw runtime_error("Snapshot holds a different kind of object.");
+        return scalar<uint64_t>();
+    }
+
+    template <typename T>
+    T scalar() {
+        require(sizeof(T));
+        T value;
+        memcpy(&value, data + pos, sizeof(T));
+        pos += sizeof(T);
+        swapToLittleEndian(&value, 1);
+        return value;
+    }
+
+    template <typename T>
+    vector<T> section(uint64_t expected_count) {
+        uint64_t bytes = scalar<uint64_t>();
+        if (expected_count > numeric_limits<uint64_t>::max() / sizeof(T) || bytes != expected_count * sizeof(T)) {
+            throw runtime_error("Snapshot section has an unexpected length.");
+        }
+        require(bytes);
+        vector<T> values(expected_count);
+        if (bytes > 0) memcpy(values.data(), data + pos, bytes); // One bulk copy per column
+        swapToLittleEndian(values.data(), values.size());
+        pos += bytes;
+        size_t padding = (8 - bytes % 8) % 8;
+        require(padding);
+        pos += padding;
+        return values;
+    }
+};
+
+/** 🔹 Flexoffers as columns; the profile and scheduled allocation of offer i are CSR ranges. */
+struct FlexofferColumns {
+    vector<int32_t> offer_ids;
+    vector<int64_t> earliest_start;
+    vector<int64_t> latest_start;
+    vector<int64_t> end_time;
+    vector<int32_t> duration;
+    vector<double> min_overall_alloc;
+    vector<double> max_overall_alloc;
+    vector<int64_t> scheduled_start;
+    vector<uint64_t> profile_offsets{0};
+    vector<double> min_power;
+    vector<double> max_power;
+    vector<uint64_t> allocation_offsets{0};
+    vector<double> allocation;
+
+    void add(const Flexoffer& fo) {
+        offer_ids.push_back(fo.get_offer_id());
+        earliest_start.push_back(fo.get_est());
+        latest_start.push_back(fo.get_lst());
+        end_time.push_back(fo.get_et());
+        duration.push_back(fo.get_duration());
+        min_overall_alloc.push_back(fo.get_min_overall_alloc());
+        max_overall_alloc.push_back(fo.get_max_overall_alloc());
+        scheduled_start.push_back(fo.get_scheduled_start_time());
+        for (const auto& ts : fo.get_profile_ref()) {
+            min_power.push_back(ts.min_power);
+            max_power.push_back(ts.max_power);
+        }
+        profile_offsets.push_back(min_power.size());
+        const auto& scheduled = fo.get_scheduled_allocation_ref();
+        allocation.insert(allocation.end(), scheduled.begin(), scheduled.end());
+        allocation_offsets.push_back(allocation.size());
+    }
+
+    void write(SnapshotWriter& writer) const {
+        writer.section(offer_ids);
+        writer.section(earliest_start);
+        writer.section(latest_start);
+        writer.section(end_time);
+        writer.section(duration);
+        writer.section(min_overall_alloc);
+        writer.section(max_overall_alloc);
+        writer.section(scheduled_start);
+        writer.section(profile_offsets);
+        writer.section(min_power);
+        writer.section(max_power);
+        writer.section(allocation_offsets);
+        writer.section(allocation);
+    }
+
+    void read(SnapshotReader& reader, uint64_t count) {
+        offer_ids = reader.section<int32_t>(count);
+        earliest_start = reader.section<int64_t>(count);
+        latest_start = reader.section<int64_t>(count);
+        end_time = reader.section<int64_t>(count);
+        duration = reader.section<int32_t>(count);
+        min_overall_alloc = reader.section<double>(count);
+        max_overall_alloc = reader.section<double>(count);
+        scheduled_start = reader.section<int64_t>(count);
+        profile_offsets = reader.section<uint64_t>(count + 1);
+        checkOffsets(profile_offsets);
+        min_power = reader.section<double>(profile_offsets.back());
+        max_power = reader.section<double>(profile_offsets.back());
+        allocation_offsets = reader.section<uint64_t>(count + 1);
+        checkOffsets(allocation_offsets);
+        allocation = reader.section<double>(allocation_offsets.back());
+    }
+
+    static void checkOffsets(const vector<uint64_t>& offsets) {
+        if (offsets.front() != 0) throw runtime_error("Snapshot offsets must start at 0.");
+        for (size_t i = 1; i < offsets.size(); i++) {
+            if (offsets[i] < offsets[i - 1]) throw runtime_error("Snapshot offsets must be non-decreasing.");
+        }
+    }
+
+    Flexoffer toFlexoffer(size_t i) const {
+        vector<TimeSlice> profile;
+        profile.reserve(profile_offsets[i + 1] - profile_offsets[i]);
+        for (uint64_t k = profile_offsets[i]; k < profile_offsets[i + 1]; k++) {
+            profile.emplace_back(min_power[k], max_power[k]);
+        }
+
+        Flexoffer fo(offer_ids[i], earliest_start[i], latest_start[i], end_time[i], profile, duration[i],
+                     min_overall_alloc[i], max_overall_alloc[i]);
+        fo.set_scheduled_start_time(scheduled_start[i]);
+        if (allocation_offsets[i + 1] > allocation_offsets[i]) { // Batches carry no schedule, keep the default then
+            fo.assign_scheduled_allocation(allocation.data() + allocation_offsets[i], allocation_offsets[i + 1] - allocation_offsets[i]);
+        }
+        return fo;
+    }
+
+    vector<Flexoffer> toFlexoffers() const {
+        vector<Flexoffer> flex_offers;
+        flex_offers.reserve(offer_ids.size());
+        for (size_t i = 0; i < offer_ids.size(); i++) flex_offers.push_back(toFlexoffer(i));
+        return flex_offers;
+    }
+};
+
+static string encodeFlexoffers(const vector<Flexoffer>& flex_offers) {
+    FlexofferColumns columns;
+    for (const auto& fo : flex_offers) columns.add(fo);
+
+    SnapshotWriter writer;
+    writer.header(FLEXOFFER_SNAPSHOT, flex_offers.size());
+    columns.write(writer);
+    return move(writer.str());
+}
+
+static FlexofferColumns decodeFlexoffers(const char* data, size_t size) {
+    SnapshotReader reader(data, size);
+    FlexofferColumns columns;
+    columns.read(reader, reader.header(FLEXOFFER_SNAPSHOT));
+    return columns;
+}
+
+static FlexofferBatch columnsToBatch(const FlexofferColumns& columns) {
+    return FlexofferBatch(vector<int>(columns.offer_ids.begin(), columns.offer_ids.end()),
+                          vector<time_t>(columns.earliest_start.begin(), columns.earliest_start.end()),
+                          vector<time_t>(columns.latest_start.begin(), columns.latest_start.end()),
+                          vector<time_t>(columns.end_time.begin(), columns.end_time.end()),
+                          vector<int>(columns.duration.begin(), columns.duration.end()),
+                          vector<size_t>(columns.profile_offsets.begin(), columns.profile_offsets.end()),
+                          columns.min_power, columns.max_power,
+                          columns.min_overall_alloc, columns.max_overall_alloc);
+}
+
+static string encodeDFOs(const vector<DFO>& dfos) {
+    vector<int32_t> dfo_ids;
+    vector<double> charging_power, min_total_energy, max_total_energy, min_prev_energy, max_prev_energy, x, y;
+    vector<int64_t> earliest_start, latest_start;
+    vector<uint64_t> polygon_offsets{0}, point_offsets{0};
+    vector<int32_t> numsamples;
+
+    for (const DFO& dfo : dfos) {
+        dfo_ids.push_back(dfo.dfo_id);
+        charging_power.push_back(dfo.charging_power);
+        min_total_energy.push_back(dfo.min_total_energy);
+        max_total_energy.push_back(dfo.max_total_energy);
+        earliest_start.push_back(dfo.earliest_start);
+        latest_start.push_back(dfo.latest_start);
+        for (const DependencyPolygon& polygon : dfo.polygons) {
+            min_prev_energy.push_back(polygon.min_prev_energy);
+            max_prev_energy.push_back(polygon.max_prev_energy);
+            numsamples.push_back(polygon.numsamples);
+            for (const Point& p : polygon.points) {
+                x.push_back(p.x);
+                y.push_back(p.y);
+            }
+            point_offsets.push_back(x.size());
+        }
+        polygon_offsets.push_back(min_prev_energy.size());
+    }
+
+    SnapshotWriter writer;
+    writer.header(DFO_SNAPSHOT, dfos.size());
+    writer.section(dfo_ids);
+    writer.section(charging_power);
+    writer.section(min_total_energy);
+    writer.section(max_total_energy);
+    writer.section(earliest_start);
+    writer.section(latest_start);
+    writer.section(polygon_offsets);
+    writer.section(min_prev_energy);
+    writer.section(max_prev_energy);
+    writer.section(numsamples);
+    writer.section(point_offsets);
+    writer.section(x);
+    writer.section(y);
+    return move(writer.str());
+}
+
+static vector<DFO> decodeDFOs(const char* data, size_t size) {
+    SnapshotReader reader(data, size);
+    uint64_t count = reader.header(DFO_SNAPSHOT);
+
+    vector<int32_t> dfo_ids = reader.section<int32_t>(count);
+    vector<double> charging_power = reader.section<double>(count);
+    vector<double> min_total_energy = reader.section<double>(count);
+    vector<double> max_total_energy = reader.section<double>(count);
+    vector<int64_t> earliest_start = reader.section<int64_t>(count);
+    vector<int64_t> latest_start = reader.section<int64_t>(count);
+    vector<uint64_t> polygon_offsets = reader.section<uint64_t>(count + 1);
+    FlexofferColumns::checkOffsets(polygon_offsets);
+    uint64_t num_polygons = polygon_offsets.back();
+    vector<double> min_prev_energy = reader.section<double>(num_polygons);
+    vector<double> max_prev_energy = reader.section<double>(num_polygons);
+    vector<int32_t> numsamples = reader.section<int32_t>(num_polygons);
+    vector<uint64_t> point_offsets = reader.section<uint64_t>(num_polygons + 1);
+    FlexofferColumns::checkOffsets(point_offsets);
+    vector<double> x = reader.section<double>(point_offsets.back());
+    vector<double> y = reader.section<double>(point_offsets.back());
+
+    vector<DFO> dfos;
+    dfos.reserve(count);
+    for (uint64_t d = 0; d < count; d++) {
+        DFO dfo(dfo_ids[d], {min_total_energy[d]}, {max_total_energy[d]}, 5, charging_power[d],
+                min_total_energy[d], max_total_energy[d], earliest_start[d]);
+        dfo.latest_start = latest_start[d];
+        dfo.polygons.clear();
+        dfo.polygons.reserve(polygon_offsets[d + 1] - polygon_offsets[d]);
+        for (uint64_t p = polygon_offsets[d]; p < polygon_offsets[d + 1]; p++) {
+            DependencyPolygon polygon(min_prev_energy[p], max_prev_energy[p], numsamples[p]);
+            polygon.points.reserve(point_offsets[p + 1] - point_offsets[p]);
+            for (uint64_t k = point_offsets[p]; k < point_offsets[p + 1]; k++) polygon.add_point(x[k], y[k]);
+            dfo.polygons.push_back(move(polygon));
+        }
+        dfos.push_back(move(dfo));
+    }
+    return dfos;
+}
+
+static string encodeGroups(const vector<Fo_Group>& groups) {
+    vector<int32_t> group_ids;
+    vector<uint64_t> group_offsets{0};
+    FlexofferColumns columns;
+    for (const Fo_Group& group : groups) {
+        group_ids.push_back(group.getGroupId());
+        for (const auto& fo : group.getFlexOffers()) columns.add(fo);
+        group_offsets.push_back(columns.offer_ids.size());
+    }
+
+    SnapshotWriter writer;
+    writer.header(GROUP_SNAPSHOT, groups.size());
+    writer.section(group_ids);
+    writer.section(group_offsets);
+    columns.write(writer);
+    return move(writer.str());
+}
+
+static vector<Fo_Group> decodeGroups(const char* data, size_t size) {
+    SnapshotReader reader(data, size);
+    uint64_t count = reader.header(GROUP_SNAPSHOT);
+    vector<int32_t> group_ids = reader.section<int32_t>(count);
+    vector<uint64_t> group_offsets = reader.section<uint64_t>(count + 1);
+    FlexofferColumns::checkOffsets(group_offsets);
+    FlexofferColumns columns;
+    columns.read(reader, group_offsets.back());
+
+    vector<Fo_Group> groups;
+    groups.reserve(count);
+    for (uint64_t g = 0; g < count; g++) {
+        Fo_Group group(group_ids[g]);
+        for (uint64_t i = group_offsets[g]; i < group_offsets[g + 1]; i++) group.addFlexOffer(columns.toFlexoffer(i));
+        groups.push_back(move(group));
+    }
+    return groups;
+}
+
+/** 🔹 Read-only view of a whole file, memory-mapped on POSIX systems and read in one go elsewhere. */
+class MappedFile {
+private:
+    const char* contents;
+    size_t length;
+    string buffer;
+    void* mapping;
+
+public:
+    explicit MappedFile(const string& path) : contents(nullptr), length(0), mapping(nullptr) {
+#ifndef _WIN32
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw runtime_error("Could not open " + path);
+        struct stat info;
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                mapping = mapped;
+                contents = static_cast<const char*>(mapped);
+                length = static_cast<size_t>(info.st_size);
+            }
+        }
+        close(fd);
+        if (mapping != nullptr) return;
+#endif
+        ifstream file(path, ios::binary);
+        if (!file) throw runtime_error("Could not open " + path);
+        buffer.assign(istreambuf_iterator<char>(file), istreambuf_iterator<char>());
+        contents = buffer.data();
+        length = buffer.size();
+    }
+
+    ~MappedFile() {
+#ifndef _WIN32
+        if (mapping != nullptr) munmap(mapping, length);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return contents; }
+    size_t size() const { return length; }
+};
+
+static void writeFile(const string& path, const string& contents) {
+    ofstream file(path, ios::binary | ios::trunc);
+    if (!file) throw runtime_error("Could not open " + path + " for writing");
+    file.write(contents.data(), static_cast<streamsize>(contents.size()));
+    if (!file) throw runtime_error("Could not write " + path);
+}
+
+string serialize_flexoffers(const vector<Flexoffer>& flex_offers) {return encodeFlexoffers(flex_offers);}
+
+vector<Flexoffer> deserialize_flexoffers(const string& data) {
+    return decodeFlexoffers(data.data(), data.size()).toFlexoffers();
+}
+
+string serialize_flexoffer_batch(const FlexofferBatch& batch) {
+    FlexofferColumns columns;
+    columns.offer_ids.assign(batch.offer_ids.begin(), batch.offer_ids.end());
+    columns.earliest_start.assign(batch.earliest_start.begin(), batch.earliest_start.end());
+    columns.latest_start.assign(batch.latest_start.begin(), batch.latest_start.end());
+    columns.end_time.assign(batch.end_time.begin(), batch.end_time.end());
+    columns.duration.assign(batch.duration.begin(), batch.duration.end());
+    columns.min_overall_alloc = batch.min_overall_alloc;
+    columns.max_overall_alloc = batch.max_overall_alloc;
+    columns.scheduled_start = columns.earliest_start; // Batches carry no schedule
+    columns.profile_offsets.assign(batch.profile_offsets.begin(), batch.profile_offsets.end());
+    columns.min_power = batch.min_power;
+    columns.max_power = batch.max_power;
+    columns.allocation_offsets.assign(batch.size() + 1, 0);
+
+    SnapshotWriter writer;
+    writer.header(FLEXOFFER_SNAPSHOT, batch.size());
+    columns.write(writer);
+    return move(writer.str());
+}
+
+FlexofferBatch deserialize_flexoffer_batch(const string& data) {
+    return columnsToBatch(decodeFlexoffers(data.data(), data.size()));
+}
+
+string serialize_dfos(const vector<DFO>& dfos) {return encodeDFOs(dfos);}
+
+vector<DFO> deserialize_dfos(const string& data) {return decodeDFOs(data.data(), data.size());}
+
+string serialize_groups(const vector<Fo_Group>& groups) {return encodeGroups(groups);}
+
+vector<Fo_Group> deserialize_groups(const string& data) {return decodeGroups(data.data(), data.size());}
+
+void save_flexoffers(const string& path, const vector<Flexoffer>& flex_offers) {writeFile(path, encodeFlexoffers(flex_offers));}
+
+vector<Flexoffer> load_flexoffers(const string& path) {
+    MappedFile file(path);
+    return decodeFlexoffers(file.data(), file.size()).toFlexoffers();
+}
+
+FlexofferBatch load_flexoffer_batch(const string& path) {
+    MappedFile file(path);
+    return columnsToBatch(decodeFlexoffers(file.data(), file.size()));
+}
+
+void save_dfos(const string& path, const vector<DFO>& dfos) {writeFile(path, encodeDFOs(dfos));}
+
+vector<DFO> load_dfos(const string& path) {
+    MappedFile file(path);
+    return decodeDFOs(file.data(), file.size());
+}
+
+void save_groups(const string& path, const vector<Fo_Group>& groups) {writeFile(path, encodeGroups(groups));}
+
+vector<Fo_Group> load_groups(const string& path) {
+    MappedFile file(path);
+    return decodeGroups(file.data(), file.size());
+}
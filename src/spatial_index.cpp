@@ -0,0 +1,141 @@
+#include "../include/spatial_index.h"
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+
+using namespace std;
+
+static int floorDiv(int value, int divisor) {
+    int q = value / divisor;
+    return (value % divisor != 0 && (value < 0) != (divisor < 0)) ? q - 1 : q;
+}
+
+MBRGrid::MBRGrid(int est_threshold, int lst_threshold)
+    : est_threshold(est_threshold), lst_threshold(lst_threshold) {
+    if (est_threshold < 0 || lst_threshold < 0) {
+        throw invalid_argument("Thresholds must be non-negative.");
+    }
+}
+
+long long MBRGrid::cellKey(int est_cell, int lst_cell) const {
+    // Shift the unsigned bit pattern, shifting a negative cell is undefined
+    unsigned long long high = static_cast<unsigned long long>(static_cast<unsigned int>(est_cell)) << 32;
+    return static_cast<long long>(high | static_cast<unsigned int>(lst_cell));
+}
+
+long long MBRGrid::cellKey(const MBR& mbr) const {
+    return cellKey(floorDiv(mbr.min_est_hour, est_threshold + 1), floorDiv(mbr.min_lst_hour, lst_threshold + 1));
+}
+
+void MBRGrid::insert(int id, const MBR& mbr) {
+    if (entries.count(id)) {
+        throw invalid_argument("Id is already in the grid.");
+    }
+    vector<int>& cell = cells[cellKey(mbr)];
+    positions[id] = cell.size();
+    cell.push_back(id);
+    entries[id] = mbr;
+}
+
+void MBRGrid::remove(int id) {
+    auto entry = entries.find(id);
+    if (entry == entries.end()) return;
+
+    auto cell_it = cells.find(cellKey(entry->second));
+    vector<int>& cell = cell_it->second;
+    size_t position = positions[id];
+    cell[position] = cell.back(); // Swap-remove, fixing the position of the moved id
+    positions[cell[position]] = position;
+    cell.pop_back();
+    if (cell.empty()) cells.erase(cell_it);
+
+    positions.erase(id);
+    entries.erase(entry);
+}
+
+void MBRGrid::update(int id, const MBR& mbr) {
+    remove(id);
+    insert(id, mbr);
+}
+
+bool MBRGrid::contains(int id) const {return entries.count(id) > 0;}
+
+size_t MBRGrid::size() const {return entries.size();}
+
+vector<int> MBRGrid::mergeCandidates(const MBR& mbr) const {
+    vector<int> candidates;
+
+    // A mergeable MBR must start within [max - threshold, min + threshold] in both dimensions
+    int est_lo = floorDiv(mbr.max_est_hour - est_threshold, est_threshold + 1);
+    int est_hi = floorDiv(mbr.min_est_hour + est_threshold, est_threshold + 1);
+    int lst_lo = floorDiv(mbr.max_lst_hour - lst_threshold, lst_threshold + 1);
+    int lst_hi = floorDiv(mbr.min_lst_hour + lst_threshold, lst_threshold + 1);
+
+    for (int e = est_lo; e <= est_hi; e++) {
+        for (int l = lst_lo; l <= lst_hi; l++) {
+            auto cell = cells.find(cellKey(e, l));
+            if (cell == cells.end()) continue;
+
+            for (int id : cell->second) {
+                const MBR& other = entries.at(id);
+                MBR merged{min(mbr.min_est_hour, other.min_est_hour), max(mbr.max_est_hour, other.max_est_hour),
+                           min(mbr.min_lst_hour, other.min_lst_hour), max(mbr.max_lst_hour, other.max_lst_hour)};
+                if (!exceedsThreshold(merged, est_threshold, lst_threshold)) candidates.push_back(id);
+            }
+        }
+    }
+    return candidates;
+}
+
+static int findRoot(vector<int>& parent, int x) {
+    while (parent[x] != x) {
+        parent[x] = parent[parent[x]];
+        x = parent[x];
+    }
+    return x;
+}
+
+vector<vector<int>> partitionMBRs(const vector<MBR>& mbrs, int est_threshold, int lst_threshold) {
+    // Units with identical MBRs always end up together, so only distinct MBRs go into the grid
+    map<tuple<int, int, int, int>, int> distinct_index;
+    vector<MBR> distinct;
+    vector<int> unit_distinct(mbrs.size());
+    for (size_t u = 0; u < mbrs.size(); u++) {
+        const MBR& m = mbrs[u];
+        auto key = make_tuple(m.min_est_hour, m.max_est_hour, m.min_lst_hour, m.max_lst_hour);
+        auto it = distinct_index.find(key);
+        if (it == distinct_index.end()) {
+            it = distinct_index.emplace(key, static_cast<int>(distinct.size())).first;
+            distinct.push_back(m);
+        }
+        unit_distinct[u] = it->second;
+    }
+
+    MBRGrid grid(est_threshold, lst_threshold);
+    for (size_t d = 0; d < distinct.size(); d++) grid.insert(static_cast<int>(d), distinct[d]);
+
+    // Union every pair of MBRs that could be merged directly
+    vector<int> parent(distinct.size());
+    iota(parent.begin(), parent.end(), 0);
+    for (size_t d = 0; d < distinct.size(); d++) {
+        for (int other : grid.mergeCandidates(distinct[d])) {
+            int a = findRoot(parent, static_cast<int>(d)), b = findRoot(parent, other);
+            if (a != b) parent[max(a, b)] = min(a, b);
+        }
+    }
+
+    vector<vector<int>> partitions;
+    vector<int> partition_of(distinct.size(), -1);
+    for (size_t u = 0; u < mbrs.size(); u++) {
+        int root = findRoot(parent, unit_distinct[u]);
+        if (partition_of[root] == -1) {
+            partition_of[root] = static_cast<int>(partitions.size());
+            partitions.emplace_back();
+        }
+        partitions[partition_of[root]].push_back(static_cast<int>(u));
+    }
+    return partitions;
+}